@@ -30,6 +30,11 @@
 #include <vector>
 #include <mutex>
 #include <chrono>
+#include <tuple>
+#include <utility>
+#include <initializer_list>
+#include <cstring>
+#include <iterator>
 
 namespace db
 {
@@ -67,6 +72,78 @@ namespace db
 		virtual statement_ptr get_statement() const = 0;
 	};
 
+	enum class lifetime
+	{
+		transient, // copied by the statement when bound
+		// Not copied; execute() keeps bindings, so the text must stay
+		// valid until the parameter is rebound, clearBindings() is
+		// called, or the statement is released.
+		stable
+	};
+
+	// Text to bind, without copying it into a std::string first. A null
+	// data pointer binds NULL; any other pointer binds text, even if
+	// the size is zero.
+	struct text_ref
+	{
+		const char* data = nullptr;
+		size_t size = 0;
+		lifetime life = lifetime::transient;
+
+		text_ref() = default;
+		text_ref(std::nullptr_t) {}
+		text_ref(const char* data, lifetime life = lifetime::transient)
+			: data(data)
+			, size(data ? strlen(data) : 0)
+			, life(life)
+		{
+		}
+		text_ref(const char* data, size_t size, lifetime life = lifetime::transient)
+			: data(data)
+			, size(size)
+			, life(life)
+		{
+		}
+		text_ref(const std::string& s, lifetime life = lifetime::transient)
+			: data(s.data())
+			, size(s.size())
+			, life(life)
+		{
+		}
+
+		bool null() const { return !data; }
+		std::string str() const { return data ? std::string { data, size } : std::string { }; }
+	};
+
+	struct statement
+	{
+		virtual ~statement() {}
+		virtual bool bind(int arg, int value) = 0;
+		virtual bool bind(int arg, short value) = 0;
+		virtual bool bind(int arg, long value) = 0;
+		virtual bool bind(int arg, long long value) = 0;
+		virtual bool bind(int arg, const char* value) = 0;
+		virtual bool bind(int arg, text_ref value) = 0;
+		virtual bool bind(int arg, time_point value) = 0;
+		virtual bool bind(int arg, std::nullptr_t) { return bindNull(arg); }
+		// Binds an empty string as NULL; use text_ref for an empty text.
+		virtual bool bind(int arg, const std::string& value)
+		{
+			if (value.empty())
+				return bind(arg, nullptr);
+			return bind(arg, text_ref { value });
+		}
+		virtual bool bindNull(int arg) = 0;
+		// Steps the statement once and rewinds it, keeping the
+		// bindings, so it can be executed again with new values.
+		virtual bool execute() = 0;
+		virtual bool reset() = 0;
+		virtual bool clearBindings() = 0;
+		virtual cursor_ptr query() = 0;
+		virtual const char* errorMessage() = 0;
+		virtual connection_ptr get_connection() const = 0;
+	};
+
 	template <typename Type> struct selector;
 	template <typename Type> struct struct_def;
 
@@ -85,61 +162,79 @@ namespace db
 	template <>
 	struct selector<const char*> { static const char* get(const cursor_ptr& c, int column) { return c->getText(column); } };
 
+	template <>
+	struct selector<text_ref> { static text_ref get(const cursor_ptr& c, int column) { return { c->getText(column), c->getLength(column) }; } };
+
 	template <>
 	struct selector<std::string> { static std::string get(const cursor_ptr& c, int column) { return c->isNull(column) ? std::string() : c->getString(column); } };
 
-	struct selector_base
+	template <typename Member>
+	static inline void read_column(const cursor_ptr& c, int column, Member& dest)
 	{
-		virtual ~selector_base() {}
-		virtual bool get(const cursor_ptr& c, void* context) = 0;
-	};
-	typedef std::shared_ptr<selector_base> selector_base_ptr;
+		dest = selector<Member>::get(c, column);
+	}
 
-	template <typename Type, typename Member>
-	struct member_selector: selector_base
+	// Assigns in place, so a row object read over and over keeps
+	// the capacity of its strings.
+	static inline void read_column(const cursor_ptr& c, int column, std::string& dest)
 	{
-		int m_column;
-		Member Type::* m_member;
-		member_selector(int column, Member Type::* member)
-			: m_column(column)
-			, m_member(member)
-		{
-		}
+		auto ptr = c->isNull(column) ? nullptr : c->getText(column);
+		if (!ptr)
+			dest.clear();
+		else
+			dest.assign(ptr, c->getLength(column));
+	}
 
-		bool get(const cursor_ptr& c, void* context)
-		{
-			Type* ctx = (Type*)context;
-			if (!ctx)
-				return false;
+	template <typename Type>
+	struct member_reader
+	{
+		const cursor_ptr& m_cursor;
+		Type& m_ctx;
 
-			ctx->*m_member = selector<Member>::get(c, m_column);
-			return true;
+		template <typename Member>
+		void operator()(int column, Member Type::* member) const
+		{
+			read_column(m_cursor, column, m_ctx.*member);
 		}
 	};
 
 	template <typename Type>
-	struct cursor_struct
+	struct member_binder
 	{
-		std::list<selector_base_ptr> m_selectors;
+		statement& m_stmt;
+		const Type& m_ctx;
+		bool m_result;
 
 		template <typename Member>
-		void add(int column, Member Type::* dest)
+		void operator()(int column, Member Type::* member)
 		{
-			m_selectors.push_back(std::make_shared< member_selector<Type, Member> >(column, dest));
+			if (m_result)
+				m_result = m_stmt.bind(column, m_ctx.*member);
 		}
+	};
 
+	// Base of the struct_def<Type> declared by CURSOR_RULE. The rule's
+	// body is a function template called with one of the visitors above,
+	// so each CURSOR_ADD resolves to a direct, inlinable call for its
+	// member, with nothing allocated and nothing virtual per column.
+	template <typename Type>
+	struct cursor_struct
+	{
 		bool get(const cursor_ptr& c, Type& ctx)
 		{
-			auto cur = m_selectors.begin(), end = m_selectors.end();
-			for (; cur != end; ++cur)
-			{
-				selector_base_ptr& selector = *cur;
-				if (!selector->get(c, &ctx))
-					return false;
-			}
+			struct_def<Type>::each(member_reader<Type> { c, ctx });
 			return true;
 		};
 
+		// Binds the members as the parameters of a statement, so
+		// the column numbers of the rule become parameter numbers.
+		bool bind(statement& stmt, const Type& ctx)
+		{
+			member_binder<Type> binder { stmt, ctx, true };
+			struct_def<Type>::each(binder);
+			return binder.m_result;
+		}
+
 		bool get(const cursor_ptr& c, std::list<Type>& ctx)
 		{
 			while (c->next())
@@ -147,7 +242,7 @@ namespace db
 				Type item;
 				if (!get(c, item))
 					return false;
-				ctx.push_back(item);
+				ctx.push_back(std::move(item));
 			}
 			return true;
 		};
@@ -159,7 +254,7 @@ namespace db
 				Type item;
 				if (!get(c, item))
 					return false;
-				ctx.push_back(item);
+				ctx.push_back(std::move(item));
 			}
 			return true;
 		};
@@ -183,27 +278,78 @@ namespace db
 		return struct_def<Type>().get(c, l);
 	}
 
-	struct statement
+	// Rows of a cursor, mapped by the CURSOR_RULE of Type one at a time
+	// into a single object, which is reused for every row. The row, with
+	// any const char* or text_ref read into it, is valid until the
+	// iterator is advanced. Like the cursor, it can be walked once.
+	template <typename Type>
+	class cursor_range
 	{
-		virtual ~statement() {}
-		virtual bool bind(int arg, int value) = 0;
-		virtual bool bind(int arg, short value) = 0;
-		virtual bool bind(int arg, long value) = 0;
-		virtual bool bind(int arg, long long value) = 0;
-		virtual bool bind(int arg, const char* value) = 0;
-		virtual bool bind(int arg, time_point value) = 0;
-		virtual bool bind(int arg, std::nullptr_t) { return bindNull(arg); }
-		virtual bool bind(int arg, const std::string& value)
+		cursor_ptr m_cursor;
+		Type m_row;
+		bool m_done = false;
+
+		void step()
 		{
-			if (value.empty())
-				return bind(arg, nullptr);
-			return bind(arg, value.c_str());
+			m_done = !m_cursor || !m_cursor->next();
+			if (!m_done)
+				struct_def<Type>().get(m_cursor, m_row);
 		}
-		virtual bool bindNull(int arg) = 0;
-		virtual bool execute() = 0;
-		virtual cursor_ptr query() = 0;
-		virtual const char* errorMessage() = 0;
-		virtual connection_ptr get_connection() const = 0;
+	public:
+		class iterator
+		{
+			cursor_range* m_range;
+			bool atEnd() const { return !m_range || m_range->m_done; }
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type = Type;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const Type*;
+			using reference = const Type&;
+
+			explicit iterator(cursor_range* range = nullptr) : m_range(range) {}
+			reference operator*() const { return m_range->m_row; }
+			pointer operator->() const { return &m_range->m_row; }
+			iterator& operator++() { m_range->step(); return *this; }
+			bool operator==(const iterator& rhs) const { return atEnd() == rhs.atEnd(); }
+			bool operator!=(const iterator& rhs) const { return atEnd() != rhs.atEnd(); }
+		};
+
+		explicit cursor_range(const cursor_ptr& c) : m_cursor(c) {}
+		iterator begin() { step(); return iterator { this }; }
+		iterator end() { return iterator { }; }
+	};
+
+	template <typename Type>
+	static inline cursor_range<Type> rows(const cursor_ptr& c)
+	{
+		return cursor_range<Type> { c };
+	}
+
+	// Calls cb with each mapped row; the same lifetime rules as for
+	// cursor_range apply to the row passed in.
+	template <typename Type, typename Callback>
+	static inline bool for_each(const cursor_ptr& c, Callback&& cb)
+	{
+		if (!c)
+			return false;
+
+		Type row;
+		struct_def<Type> def;
+		while (c->next())
+		{
+			def.get(c, row);
+			cb(static_cast<const Type&>(row));
+		}
+		return true;
+	}
+
+	struct statement_cache_stats
+	{
+		size_t hits = 0;
+		size_t misses = 0;
+		size_t size = 0;
+		size_t capacity = 0;
 	};
 
 	struct connection
@@ -221,6 +367,8 @@ namespace db
 		virtual bool beginTransaction() const = 0;
 		virtual bool rollbackTransaction() const = 0;
 		virtual bool commitTransaction() const = 0;
+		virtual statement_cache_stats cacheStats() const { return { }; }
+		virtual void cacheCapacity(size_t) {}
 	};
 
 	struct transaction
@@ -286,6 +434,67 @@ namespace db
 		bool commited() const { return m_state == COMMITED; }
 	};
 
+	template <typename Type>
+	struct row_binder
+	{
+		struct_def<Type> m_def;
+		bool bind(statement& stmt, const Type& row) { return m_def.bind(stmt, row); }
+	};
+
+	template <typename... Args>
+	struct row_binder< std::tuple<Args...> >
+	{
+		template <size_t... Index>
+		static bool bind(statement& stmt, const std::tuple<Args...>& row, std::index_sequence<Index...>)
+		{
+			bool ret = true;
+			(void)std::initializer_list<int>{ (ret = ret && stmt.bind((int)Index, std::get<Index>(row)), 0)... };
+			return ret;
+		}
+
+		bool bind(statement& stmt, const std::tuple<Args...>& row)
+		{
+			return bind(stmt, row, std::index_sequence_for<Args...>{});
+		}
+	};
+
+	// Binds and executes the statement once for every row. The rows
+	// are either tuples, bound in order, or types with a CURSOR_RULE,
+	// bound by the rule's column numbers.
+	template <typename Range>
+	static inline bool execute_all(const statement_ptr& stmt, const Range& rows)
+	{
+		if (!stmt)
+			return false;
+
+		row_binder<typename std::decay<decltype(*std::begin(rows))>::type> binder;
+		for (auto& row : rows)
+		{
+			if (!binder.bind(*stmt, row) || !stmt->execute())
+			{
+				stmt->reset();
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// execute_all in a transaction of its own; inside an already open
+	// transaction, call execute_all directly.
+	template <typename Range>
+	static inline bool insert_all(const connection_ptr& conn, const char* sql, const Range& rows)
+	{
+		transaction tr { conn };
+		if (!tr.begin())
+			return false;
+
+		if (!execute_all(conn->prepare(sql), rows))
+			return false;
+
+		return tr.commit();
+	}
+
 	class database_helper
 	{
 		std::string m_path;
@@ -312,9 +521,11 @@ namespace db
 	struct struct_def<type>: cursor_struct<type> \
 	{ \
 		typedef type Type; \
-		struct_def(); \
+		template <typename Visitor> \
+		static void each(Visitor&& add); \
 	}; \
-	struct_def<type>::struct_def()
+	template <typename Visitor> \
+	void struct_def<type>::each(Visitor&& add)
 #define CURSOR_ADD(column, name) add(column, &Type::name)
 
 #endif //__DBCONN_H__
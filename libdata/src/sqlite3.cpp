@@ -44,16 +44,19 @@ namespace db { namespace sqlite3 {
 		: m_connected(false)
 		, m_db(nullptr)
 	{
+		m_stats.capacity = default_cache_capacity;
 	}
 
 	sqlite3_connection::~sqlite3_connection()
 	{
+		clearCache();
 		if (m_connected)
 			sqlite3_close(m_db);
 	}
 
 	bool sqlite3_connection::connect(const std::string& filename)
 	{
+		clearCache();
 		m_path = filename;
 		m_connected = sqlite3_open(filename.c_str(), &m_db) == SQLITE_OK;
 		return m_connected;
@@ -86,21 +89,108 @@ namespace db { namespace sqlite3 {
 
 	statement_ptr sqlite3_connection::prepare(const char* sql) const
 	{
-		sqlite3_stmt* stmtptr = nullptr;
-		size_t len = sql ? strlen(sql) + 1 : 0;
-		if (sqlite3_prepare(m_db, sql, (int)len, &stmtptr, nullptr) || stmtptr == nullptr)
+		if (!sql)
 			return nullptr;
 
+		sqlite3_stmt* stmtptr = nullptr;
 		try {
-			auto stmt = std::make_shared<sqlite3_statement>(m_db, stmtptr,
-				const_cast<sqlite3_connection*>(this)->shared_from_this());
-			return stmt;
+			std::string key { sql };
+			stmtptr = fromCache(key);
+			if (!stmtptr && (sqlite3_prepare_v2(m_db, key.c_str(), (int)key.length() + 1, &stmtptr, nullptr) || stmtptr == nullptr))
+				return nullptr;
+
+			auto self = const_cast<sqlite3_connection*>(this);
+			return std::make_shared<sqlite3_statement>(m_db, stmtptr,
+				self->shared_from_this(), self, std::move(key));
 		} catch(std::bad_alloc) {
 			sqlite3_finalize(stmtptr);
 			return nullptr;
 		}
 	}
 
+	sqlite3_stmt* sqlite3_connection::fromCache(const std::string& sql) const
+	{
+		std::lock_guard<std::mutex> lock { m_cacheGuard };
+		auto it = m_cacheIndex.find(sql);
+		if (it == m_cacheIndex.end()) {
+			++m_stats.misses;
+			return nullptr;
+		}
+
+		++m_stats.hits;
+		auto stmt = it->second->stmt;
+		m_cache.erase(it->second);
+		m_cacheIndex.erase(it);
+		m_stats.size = m_cache.size();
+		return stmt;
+	}
+
+	void sqlite3_connection::giveBack(db_handle* db, sqlite3_stmt* stmt, std::string& sql)
+	{
+		sqlite3_reset(stmt);
+		sqlite3_clear_bindings(stmt);
+
+		std::lock_guard<std::mutex> lock { m_cacheGuard };
+
+		// statements of a previous connection, a disabled cache or
+		// a second copy of an already cached statement
+		if (db != m_db || !m_stats.capacity || m_cacheIndex.count(sql)) {
+			sqlite3_finalize(stmt);
+			return;
+		}
+
+		try {
+			m_cache.push_front({ std::move(sql), stmt });
+		} catch(std::bad_alloc) {
+			sqlite3_finalize(stmt);
+			return;
+		}
+
+		try {
+			m_cacheIndex[m_cache.front().sql] = m_cache.begin();
+		} catch(std::bad_alloc) {
+			m_cache.pop_front();
+			sqlite3_finalize(stmt);
+			return;
+		}
+
+		trimCache();
+	}
+
+	void sqlite3_connection::trimCache() const
+	{
+		while (m_cache.size() > m_stats.capacity) {
+			auto& last = m_cache.back();
+			m_cacheIndex.erase(last.sql);
+			sqlite3_finalize(last.stmt);
+			m_cache.pop_back();
+		}
+		m_stats.size = m_cache.size();
+	}
+
+	void sqlite3_connection::clearCache()
+	{
+		std::lock_guard<std::mutex> lock { m_cacheGuard };
+		for (auto& cached : m_cache)
+			sqlite3_finalize(cached.stmt);
+		m_cache.clear();
+		m_cacheIndex.clear();
+		m_stats.size = 0;
+	}
+
+	statement_cache_stats sqlite3_connection::cacheStats() const
+	{
+		std::lock_guard<std::mutex> lock { m_cacheGuard };
+		return m_stats;
+	}
+
+	void sqlite3_connection::cacheCapacity(size_t capacity)
+	{
+		std::lock_guard<std::mutex> lock { m_cacheGuard };
+		m_stats.capacity = capacity;
+		trimCache();
+	}
+
 	statement_ptr sqlite3_connection::prepare(const char* sql, long lowLimit, long hiLimit) const
 	{
 		std::ostringstream s;
@@ -150,48 +240,89 @@ namespace db { namespace sqlite3 {
 		return sqlite3_exec(db, stmt, nullptr, nullptr, nullptr) == SQLITE_OK;
 	}
 
+	sqlite3_statement::~sqlite3_statement()
+	{
+		m_owner->giveBack(m_db, m_stmt, m_sql);
+		m_stmt = nullptr;
+	}
+
 	bool sqlite3_statement::bind(int arg, short value)
 	{
+		rewind();
 		return sqlite3_bind_int(m_stmt, arg + 1, value) == SQLITE_OK;
 	}
 
 	bool sqlite3_statement::bind(int arg, long value)
 	{
+		rewind();
 		return sqlite3_bind_int(m_stmt, arg + 1, value) == SQLITE_OK;
 	}
 
 	bool sqlite3_statement::bind(int arg, long long value)
 	{
+		rewind();
 		return sqlite3_bind_int64(m_stmt, arg + 1, value) == SQLITE_OK;
 	}
 
 	bool sqlite3_statement::bind(int arg, const char* value)
 	{
-		if (!value)
+		return bind(arg, text_ref { value });
+	}
+
+	bool sqlite3_statement::bind(int arg, text_ref value)
+	{
+		if (value.null())
 			return bindNull(arg);
 
-		size_t len = strlen(value);
-		return sqlite3_bind_text(m_stmt, arg + 1, value, (int) len, SQLITE_TRANSIENT) == SQLITE_OK;
+		rewind();
+		auto destructor = value.life == lifetime::stable ? SQLITE_STATIC : SQLITE_TRANSIENT;
+		return sqlite3_bind_text64(m_stmt, arg + 1, value.data, value.size, destructor, SQLITE_UTF8) == SQLITE_OK;
 	}
 
 	bool sqlite3_statement::bind(int arg, time_point value)
 	{
+		rewind();
 		return sqlite3_bind_int64(m_stmt, arg + 1, time_point::clock::to_time_t(value)) == SQLITE_OK;
 	}
 
 	bool sqlite3_statement::bindNull(int arg)
 	{
+		rewind();
 		return sqlite3_bind_null(m_stmt, arg + 1) == SQLITE_OK;
 	}
 
 	bool sqlite3_statement::execute()
 	{
 		auto ret = sqlite3_step(m_stmt);
+		sqlite3_reset(m_stmt);
 		return ret == SQLITE_OK || ret == SQLITE_DONE;
 	}
 
+	void sqlite3_statement::rewind()
+	{
+		// a cursor left in the middle of its rows would make
+		// the binds fail with SQLITE_MISUSE
+		if (sqlite3_stmt_busy(m_stmt))
+			sqlite3_reset(m_stmt);
+	}
+
+	bool sqlite3_statement::reset()
+	{
+		// with prepare_v2, sqlite3_reset repeats the error of the last
+		// step, which has already been reported by execute or next
+		sqlite3_reset(m_stmt);
+		return true;
+	}
+
+	bool sqlite3_statement::clearBindings()
+	{
+		rewind();
+		return sqlite3_clear_bindings(m_stmt) == SQLITE_OK;
+	}
+
 	cursor_ptr sqlite3_statement::query()
 	{
+		sqlite3_reset(m_stmt);
 		try {
 			return std::make_shared<sqlite3_cursor>(m_db, m_stmt, shared_from_this());
 		} catch(std::bad_alloc) { return nullptr; }
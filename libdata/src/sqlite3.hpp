@@ -27,6 +27,9 @@
 
 #include "sqlite3.h"
 #include <data/dbconn.hpp>
+#include <list>
+#include <string>
+#include <unordered_map>
 
 namespace db
 {
@@ -35,6 +38,8 @@ namespace db
 		connection_ptr open(const std::string& path);
 
 		typedef ::sqlite3 db_handle;
+		class sqlite3_connection;
+
 		class sqlite3_cursor : public cursor
 		{
 			statement_ptr m_parent;
@@ -66,29 +71,33 @@ namespace db
 		class sqlite3_statement : public statement, public std::enable_shared_from_this<sqlite3_statement>
 		{
 			connection_ptr m_parent;
+			sqlite3_connection* m_owner;
 			db_handle* m_db;
 			sqlite3_stmt* m_stmt;
+			std::string m_sql;
+
+			void rewind();
 		public:
-			sqlite3_statement(db_handle* db, sqlite3_stmt *stmt, std::shared_ptr<connection> parent)
+			sqlite3_statement(db_handle* db, sqlite3_stmt *stmt, std::shared_ptr<connection> parent, sqlite3_connection* owner, std::string sql)
 				: m_parent(parent)
+				, m_owner(owner)
 				, m_db(db)
 				, m_stmt(stmt)
+				, m_sql(std::move(sql))
 			{
 			}
-			~sqlite3_statement()
-			{
-				sqlite3_finalize(m_stmt);
-				m_stmt = nullptr;
-
-			}
+			~sqlite3_statement();
 			bool bind(int arg, int value) override { return bind(arg, (long) value); }
 			bool bind(int arg, short value) override;
 			bool bind(int arg, long value) override;
 			bool bind(int arg, long long value) override;
 			bool bind(int arg, const char* value) override;
+			bool bind(int arg, text_ref value) override;
 			bool bind(int arg, time_point value) override;
 			bool bindNull(int arg) override;
 			bool execute() override;
+			bool reset() override;
+			bool clearBindings() override;
 			cursor_ptr query() override;
 			const char* errorMessage() override;
 			connection_ptr get_connection() const override { return m_parent; }
@@ -96,10 +105,33 @@ namespace db
 
 		class sqlite3_connection : public connection, public std::enable_shared_from_this<connection>
 		{
+			struct cached_statement
+			{
+				std::string sql;
+				sqlite3_stmt* stmt;
+			};
+			using cache_list = std::list<cached_statement>;
+
 			db_handle* m_db;
 			bool m_connected;
 			std::string m_path;
+
+			// Idle statements, most recently used first. A statement
+			// is taken out of the cache by prepare() and put back,
+			// reset and with bindings cleared, when the last reference
+			// to its sqlite3_statement is gone, so a statement is never
+			// handed out twice at the same time.
+			mutable std::mutex m_cacheGuard;
+			mutable cache_list m_cache;
+			mutable std::unordered_map<std::string, cache_list::iterator> m_cacheIndex;
+			mutable statement_cache_stats m_stats;
+
+			sqlite3_stmt* fromCache(const std::string& sql) const;
+			void clearCache();
+			void trimCache() const;
 		public:
+			static constexpr size_t default_cache_capacity = 32;
+
 			sqlite3_connection();
 			~sqlite3_connection();
 			bool connect(const std::string& filename);
@@ -118,6 +150,10 @@ namespace db
 			bool beginTransaction() const override;
 			bool rollbackTransaction() const override;
 			bool commitTransaction() const override;
+
+			statement_cache_stats cacheStats() const override;
+			void cacheCapacity(size_t capacity) override;
+			void giveBack(db_handle* db, sqlite3_stmt* stmt, std::string& sql);
 		};
 	}
 }
@@ -25,6 +25,8 @@
 #include <dom/dom.hpp>
 #include <dom/dom_xpath.hpp>
 #include <dom/parsers/xml.hpp>
+#include "nodes/element.hpp"
+#include "nodes/document.hpp"
 #include <vector>
 #include <iterator>
 #include <string.h>
@@ -35,28 +37,10 @@
 
 namespace dom {
 
-#if 0
-	DocumentPtr Document::fromFile(const filesystem::path& path)
+	DocumentPtr Document::fromFile(const std::string& path)
 	{
-		auto parser = parsers::xml::create(std::string());
-		if (parser)
-		{
-			auto doc = parsers::parseFile(parser, path);
-			if (doc)
-				return doc;
-		}
-
-		parser = parsers::html::create(std::string());
-		if (parser)
-		{
-			auto doc = parsers::parseFile(parser, path);
-			if (doc)
-				return doc;
-		}
-
-		return nullptr;
+		return parsers::parseFile(parsers::xml::create(std::string()), path);
 	}
-#endif
 
 	void Print(const NodeListPtr& subs, bool ignorews, size_t depth)
 	{
@@ -68,103 +52,164 @@ namespace dom {
 		}
 	}
 
-	template <typename T>
-	inline std::string qName(std::shared_ptr<T> ptr)
+	bool walk(Node& node, Visitor& visitor)
+	{
+		auto action = visitor.onEnter(node);
+		if (action == Visitor::STOP)
+			return false;
+
+		if (action == Visitor::CONTINUE)
+		{
+			// only the document has no implementation data
+			auto data = (impl::NodeImplInit*)node.internalData();
+			if (!data && node.nodeType() == DOCUMENT_NODE)
+			{
+				auto doc = static_cast<impl::Document*>(static_cast<Document*>(&node));
+				auto top = doc->topNode();
+				if (top && top->nodeType() == DOCUMENT_FRAGMENT_NODE)
+					data = (impl::NodeImplInit*)top->internalData();
+				else if (top && !walk(*top, visitor))
+					return false;
+			}
+
+			if (data)
+			{
+				for (auto& child : data->children)
+				{
+					if (child && !walk(*child, visitor))
+						return false;
+				}
+			}
+		}
+
+		return visitor.onLeave(node);
+	}
+
+	static inline std::string qName(const QName& qname)
 	{
-		QName qname = ptr->nodeQName();
 		if (qname.nsName.empty()) return qname.localName;
 		return "{" + qname.nsName + "}" + qname.localName;
 	}
 
-	void Print(const NodePtr& node, bool ignorews, size_t depth)
+	static inline std::string trim(const std::string& val)
+	{
+		size_t lo = 0, hi = val.length();
+		while (lo < hi && isspace((unsigned char)val[lo])) lo++;
+		while (lo < hi && isspace((unsigned char)val[hi-1])) hi--;
+		return val.substr(lo, hi - lo);
+	}
+
+	static inline void emit(const std::string& out)
 	{
-		NodeListPtr subs = node->childNodes();
+		fprintf(stderr, "%s", out.c_str());
+#ifdef WIN32
+		OutputDebugStringA(out.c_str());
+#endif
+	}
 
-		NODE_TYPE type = node->nodeType();
-		std::string out;
-		for (size_t i = 0; i < depth; ++i) out += "    ";
+	class Printer : public Visitor
+	{
+		bool m_ignorews;
+		size_t m_depth;
 
-		if (type == TEXT_NODE)
+		std::string indent() const
 		{
-			std::string val = node->nodeValue();
-			if (ignorews)
-			{
-				size_t lo = 0, hi = val.length();
-				while (lo < hi && val[lo] && isspace((unsigned char)val[lo])) lo++;
-				while (lo < hi && isspace((unsigned char)val[hi-1])) hi--;
-				val = val.substr(lo, hi - lo);
-				if (val.empty()) return;
-			}
-			if (val.length() > 80)
-				val = val.substr(0, 77) + "[...]";
-			out += "# " + val;
+			std::string out;
+			for (size_t i = 0; i < m_depth; ++i) out += "    ";
+			return out;
+		}
+
+		static std::string attributes(Node& node)
+		{
+			auto elem = static_cast<impl::Element*>(static_cast<Element*>(&node));
+			std::string out;
+			size_t count = elem->attributeCount();
+			for (size_t i = 0; i < count; ++i)
+				out += " " + qName(*elem->attributeQName(i)) + "='" + elem->attributeValue(i) + "'";
+			return out;
 		}
-		else if (type == ELEMENT_NODE)
+
+		ACTION element(Node& node)
 		{
-			std::string sattrs;
-			auto e = std::static_pointer_cast<Element>(node);
-			NodeListPtr attrs;
-			if (e) attrs = e->getAttributes();
-			if (attrs)
+			auto& children = ((impl::NodeImplInit*)node.internalData())->children;
+			std::string out = indent();
+			std::string sattrs = attributes(node);
+
+			if (children.size() == 1 && children[0] && children[0]->nodeType() == TEXT_NODE)
 			{
-				size_t count = attrs->length();
-				for(size_t i = 0; i < count; ++i)
+				std::string val = children[0]->nodeValue();
+				if (m_ignorews)
 				{
-					NodePtr node = attrs->item(i);
-					sattrs += " " + qName(node) + "='" + node->nodeValue() + "'";
+					val = trim(val);
+					if (val.empty()) return SKIP;
 				}
+				if (val.length() > 80)
+					val = val.substr(0, 77) + "[...]";
+
+				out += qName(node.nodeQName());
+				if (!sattrs.empty())
+					out += "[" + sattrs + " ]";
+				emit(out + ": " + val + "\n");
+				return SKIP;
 			}
 
-			if (subs && subs->length() == 1)
+			if (children.empty())
 			{
-				NodePtr sub = subs->item(0);
-				if (sub && sub->nodeType() == TEXT_NODE)
-				{
-					out += qName(node);
-					if (!sattrs.empty())
-						out += "[" + sattrs + " ]";
-
-					std::string val = sub->nodeValue();
-					if (ignorews)
-					{
-						size_t lo = 0, hi = val.length();
-						while (val[lo] && isspace((unsigned char)val[lo])) lo++;
-						while (lo < hi && isspace((unsigned char)val[hi-1])) hi--;
-						val = val.substr(lo, hi - lo);
-						if (val.empty()) return;
-					}
+				out += qName(node.nodeQName());
+				if (!sattrs.empty())
+					out += "[" + sattrs + " ]";
+				emit(out + "\n");
+				return SKIP;
+			}
 
+			emit(out + "<" + qName(node.nodeQName()) + sattrs + ">\n");
+			return CONTINUE;
+		}
+
+	public:
+		Printer(bool ignorews, size_t depth) : m_ignorews(ignorews), m_depth(depth) {}
+
+		ACTION onEnter(Node& node) override
+		{
+			ACTION action = CONTINUE;
+			switch (node.nodeType())
+			{
+			case TEXT_NODE:
+			{
+				std::string val = node.nodeValue();
+				if (m_ignorews)
+					val = trim(val);
+				if (!m_ignorews || !val.empty())
+				{
 					if (val.length() > 80)
 						val = val.substr(0, 77) + "[...]";
-
-					out += ": " + val + "\n";
-					fprintf(stderr, "%s", out.c_str());
-#ifdef WIN32
-					OutputDebugStringA(out.c_str());
-#endif
-					return;
+					emit(indent() + "# " + val + "\n");
 				}
+				action = SKIP;
+				break;
 			}
-			if (!subs || subs->length() == 0)
-			{
-					out += qName(node);
-					if (!sattrs.empty())
-						out += "[" + sattrs + " ]";
-					out += "\n";
-					fprintf(stderr, "%s", out.c_str());
-#ifdef WIN32
-					OutputDebugStringA(out.c_str());
-#endif
-					return;
+			case ELEMENT_NODE:
+				action = element(node);
+				break;
+			default:
+				emit(indent() + "\n");
+				break;
 			}
-			out += "<" + qName(node) + sattrs + ">";
+
+			++m_depth;
+			return action;
 		}
-		out += "\n";
-		fprintf(stderr, "%s", out.c_str());
-#ifdef WIN32
-		OutputDebugStringA(out.c_str());
-#endif
 
-		Print(subs, ignorews, depth+1);
+		bool onLeave(Node&) override
+		{
+			--m_depth;
+			return true;
+		}
+	};
+
+	void Print(const NodePtr& node, bool ignorews, size_t depth)
+	{
+		Printer printer(ignorews, depth);
+		walk(node, printer);
 	}
 }
@@ -24,7 +24,12 @@
 
 #include <dom/dom.hpp>
 #include <dom/dom_xpath.hpp>
+#include "nodes/element.hpp"
+#include "nodes/document.hpp"
 #include <vector>
+#include <list>
+#include <deque>
+#include <unordered_map>
 #include <string.h>
 
 namespace dom {
@@ -78,211 +83,529 @@ namespace dom { namespace xpath {
 		return true;
 	}
 
-	bool SimpleSelector::passable(NodePtr& node)
+	// The evaluator walks the tree through the implementation data
+	// directly; shared_ptrs are only created for the nodes it returns.
+
+	static inline impl::Document* asDocument(Node* node)
+	{
+		return static_cast<impl::Document*>(static_cast<dom::Document*>(node));
+	}
+
+	static inline Node* parentOf(Node* node)
+	{
+		auto data = (impl::NodeImplInit*)node->internalData();
+		if (!data)
+			return nullptr;
+		// the parent is owned by its own parent or the document, both
+		// of which outlive the evaluation
+		return data->parent.lock().get();
+	}
+
+	static inline NodePtr shared(Node* node)
+	{
+		if (node->nodeType() == DOCUMENT_NODE)
+			return asDocument(node)->shared_from_this();
+		auto data = (impl::NodeImplInit*)node->internalData();
+		return data->self();
+	}
+
+	// Calls fn for each child, until fn returns false; returns false,
+	// if it was stopped.
+	template <typename F>
+	static inline bool forEachChild(Node* context, F&& fn)
+	{
+		if (context->nodeType() == DOCUMENT_NODE)
+		{
+			auto doc = asDocument(context);
+			auto fragment = doc->associatedFragment();
+			if (fragment)
+				return forEachChild(fragment.get(), fn);
+			auto root = doc->documentElement();
+			if (root)
+				return fn(root.get());
+			return true;
+		}
+
+		auto data = (impl::NodeImplInit*)context->internalData();
+		if (!data)
+			return true;
+		for (auto& child : data->children)
+		{
+			if (!fn(child.get()))
+				return false;
+		}
+		return true;
+	}
+
+	// A selector's name, resolved to the atom of a name table. Every
+	// node visited by an evaluation is already in its document, so its
+	// name is already in the table; the resolution is only kept for the
+	// length of one evaluation.
+	class NameMatch
+	{
+		const QName& m_name;
+		bool m_wildcard;
+		const impl::NameTable* m_names = nullptr;
+		const QName* m_atom = nullptr;
+	public:
+		explicit NameMatch(const QName& name)
+			: m_name(name)
+			, m_wildcard(name.nsName == "*" || name.localName == "*" ||
+				(name.nsName.empty() && name.localName.empty()))
+		{
+		}
+
+		bool operator()(const impl::NameTable* names, const QName* qname)
+		{
+			if (m_wildcard)
+				return like(*qname, m_name);
+
+			if (m_names != names)
+			{
+				m_names = names;
+				m_atom = names->find(m_name);
+			}
+
+			return qname == m_atom;
+		}
+
+		bool operator()(Node* node)
+		{
+			auto data = (impl::NodeImplInit*)node->internalData();
+			if (!data || !data->names)
+				return like(node->nodeQName(), m_name);
+
+			return (*this)(data->names.get(), data->qname);
+		}
+
+		const QName* name() const { return &m_name; }
+	};
+
+	// State of one find or findall, kept on its stack, so the compiled
+	// XPath is never written to and can be shared.
+	class Evaluation
+	{
+		// deque: callers up the stack hold on to their entries
+		std::deque<NameMatch> m_matches;
+	public:
+		NameMatch& match(const SimpleSelector& sel)
+		{
+			// a path has a handful of names at most
+			for (auto& match : m_matches)
+			{
+				if (match.name() == &sel.m_name)
+					return match;
+			}
+			m_matches.emplace_back(sel.m_name);
+			return m_matches.back();
+		}
+	};
+
+	bool SimpleSelector::passable(Node*& node, NameMatch& match) const
 	{
 		switch(m_test)
 		{
 		case TEST_NODE: return true;
 		case TEST_TEXT: return node->nodeType() == TEXT_NODE;
 		case TEST_DOCUMENT_NODE:
-			node = node->ownerDocument();
-			return true;
+			if (node->nodeType() != DOCUMENT_NODE)
+			{
+				auto data = (impl::NodeImplInit*)node->internalData();
+				node = data ? data->document.lock().get() : nullptr;
+			}
+			return node != nullptr;
 		case TEST_ELEMENT:
 			if (node->nodeType() != ELEMENT_NODE)
 				return false;
-			return like(node->nodeQName(), m_name);
+			return match(node);
 		case TEST_ATTRIBUTE:
 			if (node->nodeType() != ATTRIBUTE_NODE)
 				return false;
-			return like(node->nodeQName(), m_name);
+			return match(node);
 		}
 		return false;
 	}
 
-	void SimpleSelector::test(const NodePtr& node, std::list<NodePtr>& list)
+	bool SimpleSelector::test(Node* node, Sink& out, NameMatch& match) const
 	{
 		auto rval = node;
-		if (passable(rval))
-			list.push_back(rval);
-	}
-	
-	void SimpleSelector::select(const NodeListPtr& nodes, std::list<NodePtr>& list)
-	{
-		size_t count = nodes ? nodes->length() : 0;
-		for (size_t i = 0; i < count; ++i)
-			test(nodes->item(i), list);
+		if (passable(rval, match))
+			return out.push(rval);
+		return true;
 	}
 
-	void SimpleSelector::select(const NodePtr& context, std::list<NodePtr>& list)
+	bool SimpleSelector::select(Node* context, Sink& out, Evaluation& eval) const
 	{
+		auto& match = eval.match(*this);
 		switch(m_axis)
 		{
 		case AXIS_CHILD:
-			attribute(context, list);
-			child(context, list);
-			return;
+			return attribute(context, out, match) && child(context, out, match);
 		case AXIS_DESCENDANT:
-			descendant(context, list);
-			return;
+			return descendant(context, out, match);
 		case AXIS_ATTRIBUTE:
-			attribute(context, list);
-			return;
+			return attribute(context, out, match);
 		case AXIS_SELF:
-			self(context, list);
-			return;
+			return self(context, out, match);
 		case AXIS_DESCENDANT_OR_SELF:
-			descendant_or_self(context, list);
-			return;
+			return descendant_or_self(context, out, match);
 		case AXIS_PARENT:
-			parent(context, list);
-			return;
+			return parent(context, out, match);
 		case AXIS_ANCESTOR:
-			ancestor(context, list);
-			return;
+			return ancestor(context, out, match);
 		case AXIS_ANCESTOR_OR_SELF:
-			ancestor_or_self(context, list);
-			return;
+			return ancestor_or_self(context, out, match);
 		}
+		return true;
 	}
 
-	void SimpleSelector::child(const NodePtr& context, std::list<NodePtr>& list)
+	bool SimpleSelector::child(Node* context, Sink& out, NameMatch& match) const
 	{
-		if (!context) return;
-		select(context->childNodes(), list);
+		if (!context) return true;
+		return forEachChild(context, [&](Node* node) { return test(node, out, match); });
 	}
 
-	void SimpleSelector::descendant(const NodePtr& context, std::list<NodePtr>& list)
+	bool SimpleSelector::descendant(Node* context, Sink& out, NameMatch& match) const
 	{
-		if (!context) return;
-		auto nodes = context->childNodes();
-		select(nodes, list);
+		if (!context) return true;
+		if (!child(context, out, match))
+			return false;
+		return forEachChild(context, [&](Node* node) { return descendant(node, out, match); });
+	}
 
-		size_t count = nodes ? nodes->length() : 0;
+	bool Sink::pushAttribute(impl::Element* elem, size_t index)
+	{
+		auto attr = elem->attributeNode(index);
+		return !attr || push(attr);
+	}
+
+	bool SimpleSelector::attribute(Node* context, Sink& out, NameMatch& match) const
+	{
+		if (!context) return true;
+		if (context->nodeType() != ELEMENT_NODE || m_test == TEST_TEXT || m_test == TEST_ELEMENT)
+			return true;
+
+		auto elem = static_cast<impl::Element*>(static_cast<dom::Element*>(context));
+		auto names = ((impl::NodeImplInit*)elem)->names.get();
+		auto count = elem->attributeCount();
 		for (size_t i = 0; i < count; ++i)
-			descendant(nodes->item(i), list);
+		{
+			// the attribute's document is the element's document
+			if (m_test == TEST_DOCUMENT_NODE)
+			{
+				if (!test(context, out, match))
+					return false;
+				continue;
+			}
+
+			// tested on the slot; the node is only created, if a sink
+			// down the line needs it
+			if (m_test == TEST_ATTRIBUTE && !match(names, elem->attributeQName(i)))
+				continue;
+
+			if (!out.pushAttribute(elem, i))
+				return false;
+		}
+		return true;
 	}
 
-	void SimpleSelector::attribute(const NodePtr& context, std::list<NodePtr>& list)
+	bool SimpleSelector::attributeEquals(Node* context, const std::string& value, Evaluation& eval) const
 	{
-		if (!context) return;
-		if (context->nodeType() == ELEMENT_NODE)
+		auto& match = eval.match(*this);
+		auto elem = static_cast<impl::Element*>(static_cast<dom::Element*>(context));
+		auto names = ((impl::NodeImplInit*)elem)->names.get();
+		auto count = elem->attributeCount();
+		for (size_t i = 0; i < count; ++i)
 		{
-			auto elem = std::static_pointer_cast<Element>(context);
-			select(elem->getAttributes(), list);
+			if (match(names, elem->attributeQName(i)) && elem->attributeValueEquals(i, value))
+				return true;
 		}
+		return false;
 	}
 
-	void SimpleSelector::self(const NodePtr& context, std::list<NodePtr>& list)
+	bool SimpleSelector::self(Node* context, Sink& out, NameMatch& match) const
 	{
-		if (!context) return;
-		test(context, list);
+		if (!context) return true;
+		return test(context, out, match);
 	}
 
-	void SimpleSelector::descendant_or_self(const NodePtr& context, std::list<NodePtr>& list)
+	bool SimpleSelector::descendant_or_self(Node* context, Sink& out, NameMatch& match) const
 	{
-		self(context, list);
-		descendant(context, list);
+		return self(context, out, match) && descendant(context, out, match);
 	}
 
-	void SimpleSelector::parent(const NodePtr& context, std::list<NodePtr>& list)
+	bool SimpleSelector::parent(Node* context, Sink& out, NameMatch& match) const
 	{
-		if (!context) return;
-		NodePtr parent = context->parentNode();
-		if (!parent) return;
-		test(parent, list);
+		if (!context) return true;
+		Node* parent = parentOf(context);
+		if (!parent) return true;
+		return test(parent, out, match);
 	}
 
-	void SimpleSelector::ancestor(const NodePtr& context, std::list<NodePtr>& list)
+	bool SimpleSelector::ancestor(Node* context, Sink& out, NameMatch& match) const
 	{
-		if (!context) return;
-		NodePtr parent = context->parentNode();
+		if (!context) return true;
+		Node* parent = parentOf(context);
 		while (parent)
 		{
-			test(parent, list);
-			parent = parent->parentNode();
+			if (!test(parent, out, match))
+				return false;
+			parent = parentOf(parent);
 		}
+		return true;
 	}
 
-	void SimpleSelector::ancestor_or_self(const NodePtr& context, std::list<NodePtr>& list)
+	bool SimpleSelector::ancestor_or_self(Node* context, Sink& out, NameMatch& match) const
 	{
-		self(context, list);
-		ancestor(context, list);
+		return self(context, out, match) && ancestor(context, out, match);
 	}
 
+	// Steps are evaluated depth-first: each node a step selects is taken
+	// through the rest of the path before the step looks for the next
+	// one. This yields the nodes in the same order, as evaluating the
+	// path one step at a time, but allows stopping at any point.
 	template <typename It>
-	std::list<NodePtr> select(It from, It to, const NodePtr& context)
+	class StepSink : public Sink
 	{
-		std::list<NodePtr> parent;
-		parent.push_back(context);
-		while (from != to)
+		It m_next, m_end;
+		Sink& m_out;
+		Evaluation& m_eval;
+	public:
+		StepSink(It next, It end, Sink& out, Evaluation& eval) : m_next(next), m_end(end), m_out(out), m_eval(eval) {}
+		bool push(Node* node) override;
+		bool pushAttribute(impl::Element* elem, size_t index) override
 		{
-			auto& query = *from;
-
-			std::list<NodePtr> list;
-			for (auto&& ctx: parent)
-			{
-				query.select(ctx, list);
-			};
-			parent = list;
-			++from;
+			// the last step hands the slot on; the steps after an
+			// attribute need its node as their context
+			if (m_next == m_end)
+				return m_out.pushAttribute(elem, index);
+			return Sink::pushAttribute(elem, index);
 		}
-		return parent;
+	};
+
+	template <typename It>
+	static bool select(It from, It to, Node* context, Sink& out, Evaluation& eval)
+	{
+		if (from == to)
+			return out.push(context);
+
+		auto next = from;
+		++next;
+		StepSink<It> sink(next, to, out, eval);
+		return from->select(context, sink, eval);
 	}
 
-	bool Predicate::test(const NodePtr& context)
+	template <typename It>
+	bool StepSink<It>::push(Node* node)
 	{
-		std::list<NodePtr> list = select(m_selectors.begin(), m_selectors.end(), context);
+		return select(m_next, m_end, node, m_out, m_eval);
+	}
+
+	// A selected node, or the element and index of a selected attribute,
+	// whose node is only created, when the result is handed out.
+	struct Hit
+	{
+		static constexpr size_t npos = (size_t)-1;
+		Node* node;
+		size_t attr;
+
+		NodePtr get() const
+		{
+			if (attr == npos)
+				return shared(node);
 
-		if (m_type == PRED_EXISTS)
-			return !list.empty();
+			auto elem = static_cast<impl::Element*>(static_cast<dom::Element*>(node));
+			auto attrNode = elem->attributeNode(attr);
+			if (!attrNode)
+				return nullptr;
+			return shared(attrNode);
+		}
+	};
+	typedef std::vector<Hit> Hits;
+
+	class CollectSink : public Sink
+	{
+		Hits& m_hits;
+		size_t m_limit;
+	public:
+		CollectSink(Hits& hits, size_t limit) : m_hits(hits), m_limit(limit) {}
+		bool push(Node* node) override
+		{
+			m_hits.push_back({ node, Hit::npos });
+			return m_hits.size() < m_limit;
+		}
+		bool pushAttribute(impl::Element* elem, size_t index) override
+		{
+			m_hits.push_back({ elem, index });
+			return m_hits.size() < m_limit;
+		}
+	};
 
-		for (auto&& node : list)
+	class PredicateSink : public Sink
+	{
+		const Predicate& m_pred;
+	public:
+		bool matched = false;
+		PredicateSink(const Predicate& pred) : m_pred(pred) {}
+		bool push(Node* node) override
 		{
-			if (node && node->stringValue() == m_value)
+			if (m_pred.m_type == PRED_EQUALS && (!node || node->stringValue() != m_pred.m_value))
 				return true;
+			matched = true;
+			return false;
 		}
-		return false;
+		bool pushAttribute(impl::Element* elem, size_t index) override
+		{
+			if (m_pred.m_type == PRED_EQUALS && !elem->attributeValueEquals(index, m_pred.m_value))
+				return true;
+			matched = true;
+			return false;
+		}
+	};
+
+	bool Predicate::test(Node* context, Evaluation& eval) const
+	{
+		// [@name='value'] compares the attribute slots in place
+		if (m_type == PRED_EQUALS && m_selectors.size() == 1 && context->nodeType() == ELEMENT_NODE)
+		{
+			auto& sel = m_selectors.front();
+			if (sel.m_test == TEST_ATTRIBUTE && (sel.m_axis == AXIS_ATTRIBUTE || sel.m_axis == AXIS_CHILD))
+				return sel.attributeEquals(context, m_value, eval);
+		}
+
+		PredicateSink sink(*this);
+		select(m_selectors.begin(), m_selectors.end(), context, sink, eval);
+		return sink.matched;
 	}
 
-	void Segment::select(const NodePtr& context, std::list<NodePtr>& list)
+	class SegmentSink : public Sink
 	{
-		std::list<NodePtr> local;
-		m_selector.select(context, local);
-		for (auto&& node: local)
+		const Predicates& m_preds;
+		Sink& m_out;
+		Evaluation& m_eval;
+	public:
+		SegmentSink(const Predicates& preds, Sink& out, Evaluation& eval) : m_preds(preds), m_out(out), m_eval(eval) {}
+		bool push(Node* node) override
 		{
-			bool add = true;
 			for (auto&& pred : m_preds)
 			{
-				if (!pred.test(node))
-				{
-					add = false;
-					break;
-				}
+				if (!pred.test(node, m_eval))
+					return true;
 			}
-			if (add)
-				list.push_back(node);
-		};
+			return m_out.push(node);
+		}
+	};
+
+	bool Segment::select(Node* context, Sink& out, Evaluation& eval) const
+	{
+		if (m_preds.empty())
+			return m_selector.select(context, out, eval);
+
+		SegmentSink sink(m_preds, out, eval);
+		return m_selector.select(context, sink, eval);
 	}
 
-	NodePtr XPath::find(const NodePtr& context)
+	NodePtr XPath::find(const NodePtr& context) const
 	{
-		std::list<NodePtr> list = select(m_segments.begin(), m_segments.end(), context);
+		if (!context)
+			return nullptr;
+
+		Hits list;
+		CollectSink sink(list, 1);
+		Evaluation eval;
+		select(m_segments.begin(), m_segments.end(), context.get(), sink, eval);
 		if (list.size())
-			return *list.begin();
+			return list.front().get();
 		return nullptr;
 	}
 
-	NodeListPtr XPath::findall(const NodePtr& context)
+	NodeListPtr XPath::findall(const NodePtr& context, size_t limit) const
 	{
-		std::list<NodePtr> list = select(m_segments.begin(), m_segments.end(), context);
+		if (!context || !limit)
+			return nullptr;
+
+		Hits list;
+		CollectSink sink(list, limit);
+		Evaluation eval;
+		select(m_segments.begin(), m_segments.end(), context.get(), sink, eval);
 		if (list.size())
 		{
-			std::vector<NodePtr> nodes(list.begin(), list.end());
+			std::vector<NodePtr> nodes;
+			nodes.reserve(list.size());
+			for (auto& hit : list)
+			{
+				auto node = hit.get();
+				if (node)
+					nodes.push_back(std::move(node));
+			}
 			return createList(nodes);
 		}
 		return nullptr;
 	}
 
+	XPathPtr compile(const std::string& xpath, const Namespaces& ns)
+	{
+		try {
+			return std::make_shared<XPath>(xpath, ns);
+		}
+		catch (std::bad_alloc) { return nullptr; }
+	}
+
+	class XPathCache
+	{
+		static constexpr size_t capacity = 64;
+		using entry = std::pair<std::string, XPathPtr>;
+		std::list<entry> m_items; // most recently used first
+		std::unordered_map<std::string, std::list<entry>::iterator> m_lookup;
+
+		static std::string key(const std::string& xpath, const Namespaces& ns)
+		{
+			std::string out = xpath;
+			for (auto item = ns; item && item->key; ++item)
+			{
+				out.push_back('\0');
+				out.append(item->key);
+				out.push_back('=');
+				out.append(item->ns);
+			}
+			return out;
+		}
+	public:
+		XPathPtr get(const std::string& xpath, const Namespaces& ns)
+		{
+			auto id = key(xpath, ns);
+			auto it = m_lookup.find(id);
+			if (it != m_lookup.end())
+			{
+				m_items.splice(m_items.begin(), m_items, it->second);
+				return it->second->second;
+			}
+
+			auto compiled = compile(xpath, ns);
+			if (!compiled)
+				return nullptr;
+
+			if (m_items.size() >= capacity)
+			{
+				m_lookup.erase(m_items.back().first);
+				m_items.pop_back();
+			}
+
+			m_items.emplace_front(id, compiled);
+			m_lookup[std::move(id)] = m_items.begin();
+			return compiled;
+		}
+	};
+
+	XPathPtr cached(const std::string& xpath, const Namespaces& ns)
+	{
+		thread_local XPathCache cache;
+		try {
+			return cache.get(xpath, ns);
+		}
+		catch (std::bad_alloc) { return nullptr; }
+	}
+
 	static const char* axis_names[] = {
 		"child",
 		"descendant",
@@ -305,7 +628,7 @@ namespace dom { namespace xpath {
 	inline const char* FindNamespace(const Namespaces& ns, const char* key)
 	{
 		NSData* item = ns;
-		while (item->key)
+		while (item && item->key)
 		{
 			if (strcmp(item->key, key) == 0) return item->ns;
 			item++;
@@ -427,7 +750,7 @@ namespace dom { namespace xpath {
 		}
 
 		//move past the name test
-		while (ptr < end && *ptr != '/' && *ptr != '[' && *ptr != '=') ++ptr;
+		while (ptr < end && *ptr != '/' && *ptr != '[' && *ptr != ']' && *ptr != '=') ++ptr;
 		if (save < ptr && *save == '@')
 		{
 			++save;
@@ -501,7 +824,7 @@ namespace dom { namespace xpath {
 			}
 		}
 		while (ptr < end && isspace((unsigned char)*ptr)) ++ptr;
-		if (ptr < end && *ptr != ']')
+		if (ptr >= end || *ptr != ']')
 			return nullptr;
 		return ptr + 1;
 	}
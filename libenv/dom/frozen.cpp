@@ -0,0 +1,551 @@
+/*
+ * Copyright (C) 2013 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <dom/frozen.hpp>
+#include "nodes/element.hpp"
+#include "nodes/document.hpp"
+#include <string.h>
+
+namespace dom {
+
+	class FreezeBuilder
+	{
+		FrozenDocument& m_out;
+		std::unordered_map<std::string, uint32_t> m_nameLookup;
+		std::unordered_map<const std::string*, uint32_t> m_namePtrs;
+		std::unordered_map<const QName*, uint32_t> m_qnamePtrs;
+
+		uint32_t name(const std::string& name)
+		{
+			auto it = m_nameLookup.find(name);
+			if (it != m_nameLookup.end())
+				return it->second;
+			uint32_t id = (uint32_t)m_out.m_names.size();
+			m_out.m_names.push_back(name);
+			m_nameLookup[name] = id;
+			return id;
+		}
+
+		uint32_t qname(const QName& qname)
+		{
+			auto it = m_out.m_qnameLookup.find(qname);
+			if (it != m_out.m_qnameLookup.end())
+				return it->second;
+			uint32_t id = (uint32_t)m_out.m_qnames.size();
+			m_out.m_qnames.push_back(qname);
+			m_out.m_qnameLookup[qname] = id;
+			return id;
+		}
+
+		// interned by the source document, so each pointer is looked
+		// up by value only once
+		uint32_t name(const std::string* ptr)
+		{
+			auto& id = m_namePtrs[ptr];
+			if (!id)
+				id = name(*ptr) + 1;
+			return id - 1;
+		}
+
+		uint32_t qname(const QName* ptr)
+		{
+			auto& id = m_qnamePtrs[ptr];
+			if (!id)
+				id = qname(*ptr) + 1;
+			return id - 1;
+		}
+
+		FrozenDocument::Index push(NODE_TYPE type, FrozenDocument::Index parent, uint32_t name, uint32_t qname, const std::string& value)
+		{
+			auto index = (FrozenDocument::Index)m_out.m_entries.size();
+			m_out.m_entries.push_back({ type, parent, index + 1, 0, name, qname, m_out.m_text.size(), value.size() });
+			m_out.m_text.append(value);
+			return index;
+		}
+
+		void attributes(impl::Element* elem, FrozenDocument::Index index)
+		{
+			auto count = elem->attributeCount();
+			m_out.m_entries[index].attrs = (FrozenDocument::Index)count;
+			for (size_t i = 0; i < count; ++i)
+				push(ATTRIBUTE_NODE, index, name(elem->attributeName(i)), qname(elem->attributeQName(i)), elem->attributeValue(i));
+		}
+
+		// Iterative, so that deeply nested documents do not run out of
+		// stack; the end of an entry is known once its last descendant
+		// has been pushed.
+		void subtree(const NodePtr& top, FrozenDocument::Index parent)
+		{
+			struct Frame
+			{
+				impl::NodeImplInit* node;
+				FrozenDocument::Index index;
+				size_t next;
+			};
+			std::vector<Frame> stack;
+
+			auto enter = [&](const NodePtr& node, FrozenDocument::Index parent) {
+				auto data = (impl::NodeImplInit*)node->internalData();
+				if (!data)
+					return;
+				auto type = node->nodeType();
+				if (type == ATTRIBUTE_NODE)
+					return;
+				auto index = push(type, parent, name(data->_name), qname(data->qname),
+					type == TEXT_NODE ? node->nodeValue() : std::string());
+				if (type == ELEMENT_NODE)
+					attributes(static_cast<impl::Element*>(static_cast<dom::Element*>(node.get())), index);
+				stack.push_back({ data, index, 0 });
+			};
+
+			enter(top, parent);
+			while (!stack.empty())
+			{
+				auto& frame = stack.back();
+				if (frame.next < frame.node->children.size())
+				{
+					auto index = frame.index;
+					auto& child = frame.node->children[frame.next++];
+					if (child)
+						enter(child, index);
+					continue;
+				}
+
+				m_out.m_entries[frame.index].end = (FrozenDocument::Index)m_out.m_entries.size();
+				stack.pop_back();
+			}
+		}
+
+	public:
+		explicit FreezeBuilder(FrozenDocument& out) : m_out(out) {}
+
+		void build(const DocumentPtr& doc)
+		{
+			push(DOCUMENT_NODE, FrozenDocument::npos, name(doc->nodeName()), qname(doc->nodeQName()), std::string());
+
+			// the document element has no parent node in the DOM; the
+			// copy keeps it that way, so paths evaluate the same on both
+			auto fragment = doc->associatedFragment();
+			if (fragment)
+			{
+				auto data = (impl::NodeImplInit*)fragment->internalData();
+				if (data)
+				{
+					for (auto& child : data->children)
+						subtree(child, FrozenDocument::npos);
+				}
+			}
+			else if (auto root = doc->documentElement())
+				subtree(root, FrozenDocument::npos);
+
+			m_out.m_entries[0].end = (FrozenDocument::Index)m_out.m_entries.size();
+		}
+	};
+
+	FrozenDocumentPtr FrozenDocument::freeze(const DocumentPtr& doc)
+	{
+		if (!doc)
+			return nullptr;
+
+		try {
+			auto out = std::make_shared<FrozenDocument>();
+			FreezeBuilder{ *out }.build(doc);
+			if (out->m_entries.size() >= npos)
+				return nullptr;
+			out->m_entries.shrink_to_fit();
+			out->m_text.shrink_to_fit();
+			return out;
+		}
+		catch (std::bad_alloc) { return nullptr; }
+	}
+
+	FrozenDocument::Index FrozenDocument::documentElement() const
+	{
+		for (Index child = firstChild(0); child != npos; child = nextSibling(child))
+		{
+			if (m_entries[child].type == ELEMENT_NODE)
+				return child;
+		}
+		return npos;
+	}
+
+	std::string FrozenDocument::stringValue(Index node) const
+	{
+		auto& entry = m_entries[node];
+		if (entry.type == TEXT_NODE || entry.type == ATTRIBUTE_NODE)
+			return nodeValue(node).str();
+
+		std::string out;
+		for (Index i = node + 1 + entry.attrs; i < entry.end; ++i)
+		{
+			if (m_entries[i].type == TEXT_NODE)
+				nodeValue(i).append_to(out);
+		}
+		return out;
+	}
+
+	FrozenDocument::Index FrozenDocument::firstChild(Index node) const
+	{
+		auto& entry = m_entries[node];
+		Index child = node + 1 + entry.attrs;
+		return child < entry.end ? child : npos;
+	}
+
+	FrozenDocument::Index FrozenDocument::nextSibling(Index node) const
+	{
+		auto& entry = m_entries[node];
+		if (entry.type == ATTRIBUTE_NODE)
+			return npos;
+
+		Index next = entry.end;
+		Index parent = entry.parent;
+		Index last = parent == npos ? m_entries[0].end : m_entries[parent].end;
+		return next < last ? next : npos;
+	}
+
+	FrozenDocument::Index FrozenDocument::getAttributeNode(Index node, const std::string& name) const
+	{
+		auto count = m_entries[node].attrs;
+		for (Index i = 0; i < count; ++i)
+		{
+			auto attr = attribute(node, i);
+			if (m_names[m_entries[attr].name] == name)
+				return attr;
+		}
+		return npos;
+	}
+
+	uint32_t FrozenDocument::findQName(const QName& qname) const
+	{
+		auto it = m_qnameLookup.find(qname);
+		if (it == m_qnameLookup.end())
+			return npos;
+		return it->second;
+	}
+
+	// Same semantics and the same order of results as the DOM evaluator
+	// in dom_xpath.cpp, over entry indices instead of nodes. The compiled
+	// path is only read, names are resolved up front into a plan.
+	class FrozenEvaluator
+	{
+		using Index = FrozenDocument::Index;
+
+		struct Predicate;
+		struct Step
+		{
+			xpath::AXIS axis;
+			xpath::TEST test;
+			const QName* name;
+			bool wildcard;
+			uint32_t id;
+			std::vector<Predicate> preds;
+		};
+		using Steps = std::vector<Step>;
+
+		struct Predicate
+		{
+			xpath::PRED type;
+			Steps steps;
+			const std::string* value;
+		};
+
+		struct Sink
+		{
+			virtual bool push(Index node) = 0;
+		};
+
+		const FrozenDocument& m_doc;
+		const std::vector<FrozenDocument::Entry>& m_entries;
+		Steps m_plan;
+
+		Step step(const xpath::SimpleSelector& sel)
+		{
+			Step out{ sel.m_axis, sel.m_test, &sel.m_name, false, FrozenDocument::npos, {} };
+			auto& name = sel.m_name;
+			out.wildcard = name.nsName == "*" || name.localName == "*" ||
+				(name.nsName.empty() && name.localName.empty());
+			if (!out.wildcard)
+				out.id = m_doc.findQName(name);
+			return out;
+		}
+
+		static bool like(const QName& name, const QName& tmplt)
+		{
+			if (tmplt.nsName.empty() && tmplt.localName.empty())
+				return true;
+			if (tmplt.nsName != "*" && tmplt.nsName != name.nsName)
+				return false;
+			if (tmplt.localName != "*" && tmplt.localName != name.localName)
+				return false;
+			return true;
+		}
+
+		bool matches(const Step& step, Index node) const
+		{
+			auto qname = m_entries[node].qname;
+			if (step.wildcard)
+				return like(m_doc.m_qnames[qname], *step.name);
+			return qname == step.id;
+		}
+
+		bool passable(const Step& step, Index& node) const
+		{
+			auto type = m_entries[node].type;
+			switch (step.test)
+			{
+			case xpath::TEST_NODE: return true;
+			case xpath::TEST_TEXT: return type == TEXT_NODE;
+			case xpath::TEST_DOCUMENT_NODE:
+				node = 0;
+				return true;
+			case xpath::TEST_ELEMENT:
+				return type == ELEMENT_NODE && matches(step, node);
+			case xpath::TEST_ATTRIBUTE:
+				return type == ATTRIBUTE_NODE && matches(step, node);
+			}
+			return false;
+		}
+
+		bool test(const Step& step, Index node, Sink& out) const
+		{
+			if (passable(step, node))
+				return out.push(node);
+			return true;
+		}
+
+		bool child(const Step& step, Index context, Sink& out) const
+		{
+			for (Index node = m_doc.firstChild(context); node != FrozenDocument::npos; node = m_doc.nextSibling(node))
+			{
+				if (!test(step, node, out))
+					return false;
+			}
+			return true;
+		}
+
+		bool descendant(const Step& step, Index context, Sink& out) const
+		{
+			if (!child(step, context, out))
+				return false;
+			for (Index node = m_doc.firstChild(context); node != FrozenDocument::npos; node = m_doc.nextSibling(node))
+			{
+				if (!descendant(step, node, out))
+					return false;
+			}
+			return true;
+		}
+
+		bool attribute(const Step& step, Index context, Sink& out) const
+		{
+			if (m_entries[context].type != ELEMENT_NODE)
+				return true;
+			if (step.test == xpath::TEST_TEXT || step.test == xpath::TEST_ELEMENT)
+				return true;
+
+			auto count = m_entries[context].attrs;
+			for (Index i = 0; i < count; ++i)
+			{
+				if (!test(step, context + 1 + i, out))
+					return false;
+			}
+			return true;
+		}
+
+		bool ancestor(const Step& step, Index context, Sink& out) const
+		{
+			for (Index node = m_entries[context].parent; node != FrozenDocument::npos; node = m_entries[node].parent)
+			{
+				if (!test(step, node, out))
+					return false;
+			}
+			return true;
+		}
+
+		bool select(const Step& step, Index context, Sink& out) const
+		{
+			switch (step.axis)
+			{
+			case xpath::AXIS_CHILD:
+				return attribute(step, context, out) && child(step, context, out);
+			case xpath::AXIS_DESCENDANT:
+				return descendant(step, context, out);
+			case xpath::AXIS_ATTRIBUTE:
+				return attribute(step, context, out);
+			case xpath::AXIS_SELF:
+				return test(step, context, out);
+			case xpath::AXIS_DESCENDANT_OR_SELF:
+				return test(step, context, out) && descendant(step, context, out);
+			case xpath::AXIS_PARENT:
+				if (m_entries[context].parent == FrozenDocument::npos)
+					return true;
+				return test(step, m_entries[context].parent, out);
+			case xpath::AXIS_ANCESTOR:
+				return ancestor(step, context, out);
+			case xpath::AXIS_ANCESTOR_OR_SELF:
+				return test(step, context, out) && ancestor(step, context, out);
+			}
+			return true;
+		}
+
+		// Compares the string value without building it.
+		bool valueEquals(Index node, const std::string& value) const
+		{
+			auto& entry = m_entries[node];
+			if (entry.type == TEXT_NODE || entry.type == ATTRIBUTE_NODE)
+				return m_doc.nodeValue(node) == value;
+
+			size_t pos = 0;
+			for (Index i = node + 1 + entry.attrs; i < entry.end; ++i)
+			{
+				if (m_entries[i].type != TEXT_NODE)
+					continue;
+				auto text = m_doc.nodeValue(i);
+				if (text.length() > value.length() - pos || memcmp(text.data(), value.data() + pos, text.length()))
+					return false;
+				pos += text.length();
+			}
+			return pos == value.length();
+		}
+
+		class StepSink : public Sink
+		{
+			const FrozenEvaluator& m_eval;
+			const Steps& m_steps;
+			size_t m_next;
+			Sink& m_out;
+		public:
+			StepSink(const FrozenEvaluator& eval, const Steps& steps, size_t next, Sink& out)
+				: m_eval(eval), m_steps(steps), m_next(next), m_out(out) {}
+			bool push(Index node) override { return m_eval.select(m_steps, m_next, node, m_out); }
+		};
+
+		class PredicateSink : public Sink
+		{
+			const FrozenEvaluator& m_eval;
+			const Predicate& m_pred;
+		public:
+			bool matched = false;
+			PredicateSink(const FrozenEvaluator& eval, const Predicate& pred) : m_eval(eval), m_pred(pred) {}
+			bool push(Index node) override
+			{
+				if (m_pred.type == xpath::PRED_EQUALS && !m_eval.valueEquals(node, *m_pred.value))
+					return true;
+				matched = true;
+				return false;
+			}
+		};
+
+		class SegmentSink : public Sink
+		{
+			const FrozenEvaluator& m_eval;
+			const std::vector<Predicate>& m_preds;
+			Sink& m_out;
+		public:
+			SegmentSink(const FrozenEvaluator& eval, const std::vector<Predicate>& preds, Sink& out)
+				: m_eval(eval), m_preds(preds), m_out(out) {}
+			bool push(Index node) override
+			{
+				for (auto& pred : m_preds)
+				{
+					PredicateSink sink(m_eval, pred);
+					m_eval.select(pred.steps, 0, node, sink);
+					if (!sink.matched)
+						return true;
+				}
+				return m_out.push(node);
+			}
+		};
+
+		bool select(const Steps& steps, size_t from, Index context, Sink& out) const
+		{
+			if (from == steps.size())
+				return out.push(context);
+
+			StepSink next(*this, steps, from + 1, out);
+			auto& step = steps[from];
+			if (step.preds.empty())
+				return select(step, context, next);
+
+			SegmentSink sink(*this, step.preds, next);
+			return select(step, context, sink);
+		}
+
+		class CollectSink : public Sink
+		{
+			std::vector<Index>& m_nodes;
+			size_t m_limit;
+		public:
+			CollectSink(std::vector<Index>& nodes, size_t limit) : m_nodes(nodes), m_limit(limit) {}
+			bool push(Index node) override
+			{
+				m_nodes.push_back(node);
+				return m_nodes.size() < m_limit;
+			}
+		};
+
+	public:
+		FrozenEvaluator(const FrozenDocument& doc, const xpath::XPath& xpath)
+			: m_doc(doc)
+			, m_entries(doc.m_entries)
+		{
+			m_plan.reserve(xpath.m_segments.size());
+			for (auto& seg : xpath.m_segments)
+			{
+				m_plan.push_back(step(seg.m_selector));
+				for (auto& pred : seg.m_preds)
+				{
+					Predicate out{ pred.m_type, {}, &pred.m_value };
+					for (auto& sel : pred.m_selectors)
+						out.steps.push_back(step(sel));
+					m_plan.back().preds.push_back(std::move(out));
+				}
+			}
+		}
+
+		void run(Index context, std::vector<Index>& out, size_t limit) const
+		{
+			CollectSink sink(out, limit);
+			select(m_plan, 0, context, sink);
+		}
+	};
+
+	FrozenDocument::Index FrozenDocument::find(const xpath::XPathPtr& xpath, Index context) const
+	{
+		auto list = findall(xpath, context, 1);
+		return list.empty() ? npos : list.front();
+	}
+
+	std::vector<FrozenDocument::Index> FrozenDocument::findall(const xpath::XPathPtr& xpath, Index context, size_t limit) const
+	{
+		std::vector<Index> out;
+		if (!xpath || !limit || context >= m_entries.size())
+			return out;
+
+		try {
+			FrozenEvaluator{ *this, *xpath }.run(context, out, limit);
+		}
+		catch (std::bad_alloc) { out.clear(); }
+		return out;
+	}
+}
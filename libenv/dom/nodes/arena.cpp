@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2013 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "arena.hpp"
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+namespace dom { namespace impl {
+
+	Arena::Arena(size_t blockSize)
+		: m_blockSize(blockSize ? blockSize : default_block)
+	{
+	}
+
+	Arena::~Arena()
+	{
+		while (m_head)
+		{
+			auto next = m_head->next;
+			free(m_head);
+			m_head = next;
+		}
+	}
+
+	void Arena::grow(size_t atLeast)
+	{
+		size_t size = m_blockSize;
+		if (size < atLeast + sizeof(Block))
+			size = atLeast + sizeof(Block);
+
+		auto block = (Block*)malloc(size);
+		if (!block)
+			throw std::bad_alloc();
+
+		block->next = m_head;
+		block->size = size;
+		m_head = block;
+		m_ptr = (char*)(block + 1);
+		m_end = (char*)block + size;
+		m_reserved += size;
+
+		if (m_blockSize < max_block)
+			m_blockSize *= 2;
+	}
+
+	void* Arena::allocate(size_t size, size_t align)
+	{
+		auto aligned = [align](char* ptr) {
+			return (char*)(((uintptr_t)ptr + align - 1) & ~(uintptr_t)(align - 1));
+		};
+
+		char* ptr = aligned(m_ptr);
+		if (!m_ptr || ptr + size > m_end)
+		{
+			grow(size + align);
+			ptr = aligned(m_ptr);
+		}
+
+		m_ptr = ptr + size;
+		m_used += size;
+		return ptr;
+	}
+
+	const char* Arena::copy(const char* data, size_t size)
+	{
+		auto ptr = (char*)allocate(size, 1);
+		memcpy(ptr, data, size);
+		return ptr;
+	}
+}}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2013 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DOM_INTERNAL_ARENA_HPP__
+#define __DOM_INTERNAL_ARENA_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace dom { namespace impl {
+
+	// Monotonic allocator: memory handed out is never reused, only
+	// released all at once, when the last reference to the arena goes
+	// away. Allocation is not thread-safe; a document and the nodes it
+	// creates are expected to be built from one thread at a time.
+	class Arena
+	{
+		struct Block
+		{
+			Block* next;
+			size_t size;
+		};
+
+		Block* m_head = nullptr;
+		char* m_ptr = nullptr;
+		char* m_end = nullptr;
+		size_t m_blockSize;
+		size_t m_used = 0;
+		size_t m_reserved = 0;
+		std::atomic<size_t> m_refs{ 0 };
+
+		void grow(size_t atLeast);
+	public:
+		static constexpr size_t default_block = 64 * 1024;
+		static constexpr size_t max_block = 1024 * 1024;
+
+		explicit Arena(size_t blockSize = default_block);
+		~Arena();
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+
+		void* allocate(size_t size, size_t align = alignof(std::max_align_t));
+		const char* copy(const char* data, size_t size);
+		size_t used() const { return m_used; }
+		size_t reserved() const { return m_reserved; }
+
+		void acquire() { ++m_refs; }
+		void release() { if (!--m_refs) delete this; }
+	};
+
+	// Intrusive handle, half the size of a shared_ptr; it is copied into
+	// the control block of every node allocated from the arena.
+	class ArenaRef
+	{
+		Arena* m_arena = nullptr;
+	public:
+		ArenaRef() = default;
+		explicit ArenaRef(Arena* arena) : m_arena(arena) { if (m_arena) m_arena->acquire(); }
+		ArenaRef(const ArenaRef& other) : ArenaRef(other.m_arena) {}
+		ArenaRef(ArenaRef&& other) : m_arena(other.m_arena) { other.m_arena = nullptr; }
+		~ArenaRef() { if (m_arena) m_arena->release(); }
+		ArenaRef& operator=(ArenaRef other)
+		{
+			std::swap(m_arena, other.m_arena);
+			return *this;
+		}
+
+		static ArenaRef create(size_t blockSize = 0)
+		{
+			return ArenaRef(new Arena(blockSize));
+		}
+
+		Arena* get() const { return m_arena; }
+		Arena* operator->() const { return m_arena; }
+		explicit operator bool() const { return !!m_arena; }
+		bool operator==(const ArenaRef& rhs) const { return m_arena == rhs.m_arena; }
+		bool operator!=(const ArenaRef& rhs) const { return m_arena != rhs.m_arena; }
+	};
+
+	// Each allocation keeps a reference to the arena, so a node handed
+	// out to the user keeps all of its siblings' memory alive, even after
+	// the document is gone.
+	template <typename T>
+	struct ArenaAllocator
+	{
+		using value_type = T;
+		ArenaRef arena;
+
+		ArenaAllocator(const ArenaRef& arena) : arena(arena) {}
+		template <typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+		T* allocate(size_t n)
+		{
+			return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T*, size_t) {}
+
+		template <typename U>
+		bool operator==(const ArenaAllocator<U>& rhs) const { return arena == rhs.arena; }
+		template <typename U>
+		bool operator!=(const ArenaAllocator<U>& rhs) const { return arena != rhs.arena; }
+	};
+}}
+
+#endif // __DOM_INTERNAL_ARENA_HPP__
@@ -34,6 +34,10 @@ namespace dom { namespace impl {
 	public:
 		Attribute(const Init& init) : NodeImpl(init) {}
 
+		// also updates the slot of the owning element
+		void nodeValue(const std::string& val) override;
+		using NodeImpl::nodeValue;
+
 		dom::NodePtr previousSibling() override
 		{
 			return { };
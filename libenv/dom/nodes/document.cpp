@@ -30,7 +30,9 @@
 
 namespace dom { namespace impl {
 
-	Document::Document()
+	Document::Document(const ArenaRef& arena)
+		: m_arena(arena)
+		, m_names(std::make_shared<NameTable>())
 	{
 		m_qname.localName = "#document";
 	}
@@ -55,6 +57,7 @@ namespace dom { namespace impl {
 	{
 		root = elem;
 		fragment = nullptr;
+		m_names->touch();
 		if (elem)
 			((NodeImplInit*)elem->internalData())->fixQName();
 	}
@@ -63,6 +66,7 @@ namespace dom { namespace impl {
 	{
 		root = nullptr;
 		fragment = f;
+		m_names->touch();
 		if (f)
 			((NodeImplInit*)f->internalData())->fixQName();
 	}
@@ -70,67 +74,246 @@ namespace dom { namespace impl {
 	{
 		NodeImplInit init;
 		init.type = ELEMENT_NODE;
-		init._name = tagName;
+		init._name = m_names->intern(tagName);
 		//init._value;
+		init.names = m_names;
 		init.document = shared_from_this();
 		init.index = 0;
-		return std::make_shared<Element>(init);
+		return make<Element>(init);
 	}
 
 	dom::TextPtr Document::createTextNode(const std::string& data)
+	{
+		return createTextNode(data.c_str(), data.length());
+	}
+
+	dom::TextPtr Document::createTextNode(const char* data, size_t size)
 	{
 		NodeImplInit init;
 		init.type = TEXT_NODE;
-		//init._name;
-		init._value = data;
+		init._name = m_names->intern(std::string());
+		init.names = m_names;
 		init.document = shared_from_this();
 		init.index = 0;
-		return std::make_shared<Text>(init);
+		if (m_arena)
+			return make<Text>(init, m_arena->copy(data, size), size);
+		init._value.assign(data, size);
+		return make<Text>(init);
 	}
 
 	dom::AttributePtr Document::createAttribute(const std::string& name, const std::string& value)
 	{
 		NodeImplInit init;
 		init.type = ATTRIBUTE_NODE;
-		init._name = name;
+		init._name = m_names->intern(name);
 		init._value = value;
+		init.names = m_names;
+		init.document = shared_from_this();
+		init.index = 0;
+		return make<Attribute>(init);
+	}
+
+	void Document::bindNS(NodeImplInit& init, const std::string& nsName, const std::string& qualifiedName)
+	{
+		init._name = m_names->intern(qualifiedName);
+		init.nsBound = true;
+
+		auto col = qualifiedName.find(':');
+		if (col == std::string::npos)
+			init.qname = m_names->intern(nsName, qualifiedName);
+		else
+			init.qname = m_names->intern(nsName, qualifiedName.substr(col + 1));
+	}
+
+	dom::ElementPtr Document::createElementNS(const std::string& nsName, const std::string& qualifiedName)
+	{
+		NodeImplInit init;
+		init.type = ELEMENT_NODE;
+		bindNS(init, nsName, qualifiedName);
+		init.names = m_names;
 		init.document = shared_from_this();
 		init.index = 0;
-		return std::make_shared<Attribute>(init);
+		return make<Element>(init);
+	}
+
+	dom::AttributePtr Document::createAttributeNS(const std::string& nsName, const std::string& qualifiedName, const std::string& value)
+	{
+		NodeImplInit init;
+		init.type = ATTRIBUTE_NODE;
+		bindNS(init, nsName, qualifiedName);
+		init._value = value;
+		init.names = m_names;
+		init.document = shared_from_this();
+		init.index = 0;
+		return make<Attribute>(init);
 	}
 
 	dom::DocumentFragmentPtr Document::createDocumentFragment()
 	{
 		NodeImplInit init;
 		init.type = DOCUMENT_FRAGMENT_NODE;
-		init._name = "#document-fragment";
+		init._name = m_names->intern("#document-fragment");
+		init.names = m_names;
 		init.document = shared_from_this();
 		init.index = 0;
-		return std::make_shared<DocumentFragment>(init);
+		return make<DocumentFragment>(init);
+	}
+
+	class TagIndexer : public Visitor
+	{
+		std::unordered_map<const std::string*, std::vector<dom::Node*>>& m_out;
+	public:
+		TagIndexer(std::unordered_map<const std::string*, std::vector<dom::Node*>>& out) : m_out(out) {}
+		ACTION onEnter(dom::Node& node) override
+		{
+			auto type = node.nodeType();
+			if (type == ELEMENT_NODE)
+				m_out[((NodeImplInit*)node.internalData())->_name].push_back(&node);
+			return type == TEXT_NODE ? SKIP : CONTINUE;
+		}
+	};
+
+	class AttrIndexer : public Visitor
+	{
+		const std::string* m_name;
+		std::unordered_map<std::string, std::vector<dom::Node*>>& m_out;
+	public:
+		AttrIndexer(const std::string* name, std::unordered_map<std::string, std::vector<dom::Node*>>& out) : m_name(name), m_out(out) {}
+		ACTION onEnter(dom::Node& node) override
+		{
+			auto type = node.nodeType();
+			if (type == ELEMENT_NODE)
+			{
+				auto elem = static_cast<Element*>(static_cast<dom::Element*>(&node));
+				auto count = elem->attributeCount();
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (elem->attributeName(i) == m_name)
+						m_out[elem->attributeValue(i)].push_back(&node);
+				}
+			}
+			return type == TEXT_NODE ? SKIP : CONTINUE;
+		}
+	};
+
+	bool Document::indexesValid()
+	{
+		if (m_indexed == m_names->generation())
+			return true;
+
+		m_byTag.clear();
+		m_byAttr.clear();
+		m_indexed = m_names->generation();
+		return false;
+	}
+
+	const Document::Elements* Document::tagIndex(const std::string& tagName)
+	{
+		auto atom = m_names->find(tagName);
+		if (!atom)
+			return nullptr;
+
+		if (!indexesValid() || m_byTag.empty())
+		{
+			TagIndexer indexer(m_byTag);
+			walk(*this, indexer);
+		}
+
+		auto it = m_byTag.find(atom);
+		if (it == m_byTag.end())
+			return nullptr;
+		return &it->second;
+	}
+
+	const Document::Elements* Document::attrIndex(const std::string& name, const std::string& value)
+	{
+		auto atom = m_names->find(name);
+		if (!atom)
+			return nullptr;
+
+		indexesValid();
+		auto it = m_byAttr.find(atom);
+		if (it == m_byAttr.end())
+		{
+			it = m_byAttr.emplace(atom, std::unordered_map<std::string, Elements>()).first;
+			AttrIndexer indexer(atom, it->second);
+			walk(*this, indexer);
+		}
+
+		auto found = it->second.find(value);
+		if (found == it->second.end())
+			return nullptr;
+		return &found->second;
+	}
+
+	NodeListPtr Document::toList(const Elements* elements)
+	{
+		NodePtrs out;
+		if (elements)
+		{
+			out.reserve(elements->size());
+			for (auto node : *elements)
+				out.push_back(((NodeImplInit*)node->internalData())->self());
+		}
+		return std::make_shared<NodeList>(out);
 	}
 
 	dom::NodeListPtr Document::getElementsByTagName(const std::string& tagName)
 	{
-		if (root)
-			return root->getElementsByTagName(tagName);
-		if (fragment)
-			return fragment->getElementsByTagName(tagName);
-		return nullptr;
+		if (!root && !fragment)
+			return nullptr;
+		try {
+			return indexedElementsByTagName(tagName);
+		}
+		catch (std::bad_alloc) { return nullptr; }
+	}
+
+	dom::NodeListPtr Document::indexedElementsByTagName(const std::string& tagName)
+	{
+		std::lock_guard<std::mutex> lock { m_indexGuard };
+		return toList(tagIndex(tagName));
 	}
 
 	dom::ElementPtr Document::getElementById(const std::string& elementId)
 	{
-		return nullptr;
+		try {
+			std::lock_guard<std::mutex> lock { m_indexGuard };
+			auto found = attrIndex("id", elementId);
+			if (!found || found->empty())
+				return nullptr;
+			return std::static_pointer_cast<dom::Element>(((NodeImplInit*)found->front()->internalData())->self());
+		}
+		catch (std::bad_alloc) { return nullptr; }
+	}
+
+	dom::NodeListPtr Document::getElementsByAttribute(const std::string& name, const std::string& value)
+	{
+		try {
+			std::lock_guard<std::mutex> lock { m_indexGuard };
+			return toList(attrIndex(name, value));
+		}
+		catch (std::bad_alloc) { return nullptr; }
 	}
 
 	NodePtr Document::find(const std::string& path, const Namespaces& ns)
 	{
-		return xpath::XPath(path, ns).find(shared_from_this());
+		auto query = xpath::cached(path, ns);
+		if (!query) return nullptr;
+		return query->find(shared_from_this());
 	}
 
 	NodeListPtr Document::findall(const std::string& path, const Namespaces& ns)
 	{
-		return xpath::XPath(path, ns).findall(shared_from_this());
+		auto query = xpath::cached(path, ns);
+		if (!query) return nullptr;
+		return query->findall(shared_from_this());
+	}
+
+	NodeListPtr Document::findall(const std::string& path, const Namespaces& ns, size_t limit)
+	{
+		auto query = xpath::cached(path, ns);
+		if (!query) return nullptr;
+		return query->findall(shared_from_this(), limit);
 	}
 }}
 
@@ -139,4 +322,12 @@ namespace dom {
 	{
 		return std::make_shared<impl::Document>();
 	}
+
+	DocumentPtr Document::createWithArena(size_t blockSize)
+	{
+		try {
+			return std::make_shared<impl::Document>(impl::ArenaRef::create(blockSize));
+		}
+		catch (std::bad_alloc) { return nullptr; }
+	}
 }
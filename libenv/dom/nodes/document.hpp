@@ -26,6 +26,8 @@
 #define __DOM_INTERNAL_DOCUMENT_HPP__
 
 #include <dom/nodes/document.hpp>
+#include "arena.hpp"
+#include "node_impl.hpp"
 
 namespace dom { namespace impl {
 
@@ -34,8 +36,35 @@ namespace dom { namespace impl {
 		QName m_qname;
 		dom::ElementPtr root;
 		dom::DocumentFragmentPtr fragment;
+		ArenaRef m_arena;
+		NameTablePtr m_names;
+
+		// Raw pointers are fine here: a stale index is never read, and
+		// the index is stale once anything has been removed. Readers
+		// build the indexes lazily, so every use of them, from the
+		// check to the copy of the result, is under m_indexGuard.
+		using Elements = std::vector<dom::Node*>;
+		std::mutex m_indexGuard;
+		size_t m_indexed = (size_t)-1; // generation of m_names the indexes are for
+		std::unordered_map<const std::string*, Elements> m_byTag;
+		std::unordered_map<const std::string*, std::unordered_map<std::string, Elements>> m_byAttr;
+
+		bool indexesValid();
+		const Elements* tagIndex(const std::string& tagName);
+		const Elements* attrIndex(const std::string& name, const std::string& value);
+		static NodeListPtr toList(const Elements* elements);
+
+		void bindNS(NodeImplInit& init, const std::string& nsName, const std::string& qualifiedName);
+
+		template <typename T, typename... Args>
+		std::shared_ptr<T> make(const NodeImplInit& init, Args&&... args)
+		{
+			if (m_arena)
+				return std::allocate_shared<T>(ArenaAllocator<T>(m_arena), init, std::forward<Args>(args)...);
+			return std::make_shared<T>(init, std::forward<Args>(args)...);
+		}
 	public:
-		Document();
+		explicit Document(const ArenaRef& arena = ArenaRef());
 
 		std::string nodeName() const override { return m_qname.localName; }
 		const QName& nodeQName() const override { return m_qname; }
@@ -57,19 +86,29 @@ namespace dom { namespace impl {
 		bool replaceChild(const NodeListPtr& newChildren, const NodePtr& oldChild) override { return false; }
 		bool removeChild(const NodePtr& child) override { return false; }
 		void* internalData() override { return nullptr; }
+		const NameTablePtr& names() const { return m_names; }
+		// the fragment or the document element, whichever is set
+		dom::Node* topNode() const { return fragment ? (dom::Node*)fragment.get() : root.get(); }
 
 		dom::ElementPtr documentElement() override { return root; }
 		void setDocumentElement(const dom::ElementPtr& elem) override;
+		void adoptDocumentElement(const dom::ElementPtr& elem) { root = elem; fragment = nullptr; m_names->touch(); } // trusted, names already resolved
 		dom::DocumentFragmentPtr associatedFragment() override { return fragment; }
 		void setFragment(const DocumentFragmentPtr& f) override;
 		dom::ElementPtr createElement(const std::string& tagName) override;
 		dom::TextPtr createTextNode(const std::string& data) override;
+		dom::TextPtr createTextNode(const char* data, size_t size);
 		dom::AttributePtr createAttribute(const std::string& name, const std::string& value) override;
+		dom::ElementPtr createElementNS(const std::string& nsName, const std::string& qualifiedName) override;
+		dom::AttributePtr createAttributeNS(const std::string& nsName, const std::string& qualifiedName, const std::string& value) override;
 		dom::DocumentFragmentPtr createDocumentFragment() override;
 		dom::NodeListPtr getElementsByTagName(const std::string& tagName) override;
 		dom::ElementPtr getElementById(const std::string& elementId) override;
+		dom::NodeListPtr getElementsByAttribute(const std::string& name, const std::string& value) override;
+		dom::NodeListPtr indexedElementsByTagName(const std::string& tagName);
 		NodePtr find(const std::string& path, const Namespaces& ns) override;
 		NodeListPtr findall(const std::string& path, const Namespaces& ns) override;
+		NodeListPtr findall(const std::string& path, const Namespaces& ns, size_t limit) override;
 	};
 }}
 
@@ -29,19 +29,18 @@ namespace dom { namespace impl {
 
 	DocumentFragment::DocumentFragment(const Init& init) : ParentNodeImpl(init) {}
 
-	void DocumentFragment::enumTagNames(const std::string& tagName, NodePtrs& out)
+	void DocumentFragment::enumTagNames(const std::string* tagName, NodePtrs& out)
 	{
-		for (auto&& node : children)
-		{
-			if (node->nodeType() == ELEMENT_NODE)
-				((Element*)node.get())->enumTagNames(tagName, out);
-		}
+		TagNameCollector collector(tagName, out);
+		walk(*this, collector);
 	}
 
 	dom::NodeListPtr DocumentFragment::getElementsByTagName(const std::string& tagName)
 	{
 		NodePtrs out;
-		enumTagNames(tagName, out);
+		auto atom = names->find(tagName);
+		if (atom)
+			enumTagNames(atom, out);
 		return std::make_shared<NodeList>(out);
 	}
 }}
@@ -31,7 +31,7 @@ namespace dom { namespace impl {
 
 	class DocumentFragment : public ParentNodeImpl<DocumentFragment, dom::DocumentFragment>
 	{
-		void enumTagNames(const std::string& tagName, NodePtrs& out);
+		void enumTagNames(const std::string* tagName, NodePtrs& out);
 
 	public:
 		DocumentFragment(const Init& init);
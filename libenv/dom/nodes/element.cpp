@@ -23,42 +23,146 @@
  */
 
 #include "element.hpp"
+#include "attribute.hpp"
+#include "document.hpp"
 #include <string.h>
 
 namespace dom { namespace impl {
 
 	Element::Element(const Init& init) : ParentNodeImpl(init), nsRebuilt(false) {}
 
+	static inline bool isNamespaceDecl(const std::string& name)
+	{
+		return strncmp(name.c_str(), "xmlns", 5) == 0 &&
+			(name.length() == 5 || name[5] == ':');
+	}
+
+	Element::AttrSlot* Element::findSlot(const std::string& name)
+	{
+		auto atom = names->find(name);
+		if (!atom)
+			return nullptr;
+
+		for (auto& slot : attrs)
+		{
+			if (slot.name == atom)
+				return &slot;
+		}
+		return nullptr;
+	}
+
+	const dom::AttributePtr& Element::materialize(AttrSlot& slot)
+	{
+		std::lock_guard<std::mutex> lock { names->nodeGuard() };
+		if (slot.node)
+			return slot.node;
+
+		try {
+			NodeImplInit init;
+			init.type = ATTRIBUTE_NODE;
+			init.nsBound = slot.nsBound;
+			init._name = slot.name;
+			init._value = slot.value;
+			init.qname = slot.qname;
+			init.names = names;
+			init.document = document;
+			init.index = 0;
+			init.parent = shared_from_this();
+			slot.node = std::make_shared<Attribute>(init);
+		}
+		catch (std::bad_alloc) {}
+
+		return slot.node;
+	}
+
+	bool Element::setSlot(const std::string* name, const QName* qname, bool nsBound, const std::string& value)
+	{
+		if (isNamespaceDecl(*name))
+			nsRebuilt = false;
+		names->touch();
+
+		for (auto& slot : attrs)
+		{
+			if (slot.name != name)
+				continue;
+
+			slot.value = value;
+			if (slot.node)
+				slot.node->value(value);
+			return true;
+		}
+
+		attrs.push_back({ name, qname, nsBound, value, nullptr });
+		return true;
+	}
+
+	void Element::attributeChanged(const dom::Attribute* node, const std::string& value)
+	{
+		for (auto& slot : attrs)
+		{
+			if (slot.node.get() == node)
+			{
+				slot.value = value;
+				return;
+			}
+		}
+	}
+
+	void Attribute::nodeValue(const std::string& val)
+	{
+		NodeImpl::nodeValue(val);
+
+		auto parent = this->parent.lock();
+		if (parent && parent->nodeType() == ELEMENT_NODE)
+			static_cast<Element*>(static_cast<dom::Element*>(parent.get()))->attributeChanged(this, val);
+	}
+
 	std::string Element::getAttribute(const std::string& name)
 	{
-		std::map< std::string, dom::AttributePtr >::const_iterator
-			_it = lookup.find(name);
-		if (_it == lookup.end()) return std::string();
-		return _it->second->value();
+		auto slot = findSlot(name);
+		if (!slot) return std::string();
+		return slot->get();
 	}
 
 	dom::AttributePtr Element::getAttributeNode(const std::string& name)
 	{
-		std::map< std::string, dom::AttributePtr >::const_iterator
-			_it = lookup.find(name);
-		if (_it == lookup.end()) return dom::AttributePtr();
-		return _it->second;
+		auto slot = findSlot(name);
+		if (!slot) return dom::AttributePtr();
+		return materialize(*slot);
 	}
 
 	bool Element::setAttribute(const dom::AttributePtr& attr)
 	{
+		if (!attr)
+			return false;
+
 		NodeImplInit* p = (NodeImplInit*)attr->internalData();
-		if (p)
-			p->parent = shared_from_this();
+		if (!p)
+			return false;
 
-		std::map< std::string, dom::AttributePtr >::const_iterator
-			_it = lookup.find(attr->name());
-		if (_it != lookup.end())
+		auto slot = findSlot(*p->_name);
+		if (slot)
 		{
-			_it->second->value(attr->value());
+			slot->value = attr->value();
+			if (slot->node)
+				slot->node->value(slot->value);
+			names->touch();
 			return true;
 		}
-		lookup[attr->name()] = attr;
+
+		// adopt the node into this document's names
+		if (p->names != names)
+		{
+			p->_name = names->intern(*p->_name);
+			p->qname = names->intern(*p->qname);
+			p->names = names;
+		}
+		p->parent = shared_from_this();
+
+		if (isNamespaceDecl(*p->_name))
+			nsRebuilt = false;
+		attrs.push_back({ p->_name, p->qname, p->nsBound, attr->value(), attr });
+		names->touch();
 		return true;
 	}
 
@@ -71,56 +175,76 @@ namespace dom { namespace impl {
 
 	bool Element::setAttribute(const std::string& attr, const std::string& value)
 	{
-		auto doc = Element::ownerDocument();
-		if (!doc)
-			return false;
-		auto attribute = doc->createAttribute(attr, value);
-		if (!attribute)
-			return false;
+		return setSlot(names->intern(attr), names->intern(std::string(), attr), false, value);
+	}
 
-		return Element::setAttribute(attribute);
+	bool Element::setAttributeNS(const std::string& nsName, const std::string& qualifiedName, const std::string& value)
+	{
+		auto col = qualifiedName.find(':');
+		auto localName = col == std::string::npos ? qualifiedName : qualifiedName.substr(col + 1);
+		return setSlot(names->intern(qualifiedName), names->intern(nsName, localName), true, value);
 	}
 
 	bool Element::removeAttribute(const std::string& attr)
 	{
-		auto it = lookup.find(attr);
-		if (it == lookup.end())
+		auto slot = findSlot(attr);
+		if (!slot)
 			return false;
-		lookup.erase(it);
+		if (isNamespaceDecl(attr))
+			nsRebuilt = false;
+		attrs.erase(attrs.begin() + (slot - attrs.data()));
+		names->touch();
 		return true;
 	}
 
 	dom::NodeListPtr Element::getAttributes()
 	{
 		NodePtrs out;
-		out.reserve(lookup.size());
-		for (auto& pair : lookup)
-			out.push_back(pair.second);
+		out.reserve(attrs.size());
+		for (auto& slot : attrs)
+		{
+			auto& node = materialize(slot);
+			if (node)
+				out.push_back(node);
+		}
 		return std::make_shared<NodeList>(out);
 	}
 
 	bool Element::hasAttribute(const std::string& name)
 	{
-		std::map< std::string, dom::AttributePtr >::const_iterator
-			_it = lookup.find(name);
-		return _it != lookup.end();
+		return findSlot(name) != nullptr;
 	}
 
-	void Element::enumTagNames(const std::string& tagName, NodePtrs& out)
+	Visitor::ACTION TagNameCollector::onEnter(dom::Node& node)
 	{
-		if (tagName == _name) out.push_back(shared_from_this());
+		auto type = node.nodeType();
+		if (type != ELEMENT_NODE)
+			return type == TEXT_NODE ? SKIP : CONTINUE;
 
-		for (auto&& node : children)
-		{
-			if (node->nodeType() == ELEMENT_NODE)
-				((Element*)node.get())->enumTagNames(tagName, out);
-		}
+		auto elem = static_cast<Element*>(static_cast<dom::Element*>(&node));
+		if (elem->_name == m_tagName)
+			m_out.push_back(elem->shared_from_this());
+		return CONTINUE;
+	}
+
+	void Element::enumTagNames(const std::string* tagName, NodePtrs& out)
+	{
+		TagNameCollector collector(tagName, out);
+		walk(*this, collector);
 	}
 
 	dom::NodeListPtr Element::getElementsByTagName(const std::string& tagName)
 	{
+		// the document element covers the whole document, which is
+		// what the document's index is for
+		auto doc = std::static_pointer_cast<Document>(document.lock());
+		if (doc && doc->topNode() == this)
+			return doc->indexedElementsByTagName(tagName);
+
 		NodePtrs out;
-		enumTagNames(tagName, out);
+		auto atom = names->find(tagName);
+		if (atom)
+			enumTagNames(atom, out);
 		return std::make_shared<NodeList>(out);
 	}
 
@@ -162,20 +286,48 @@ namespace dom { namespace impl {
 		return out;
 	}
 
+	void Element::rehome(const std::shared_ptr<dom::Document>& doc, NameRemap& remap)
+	{
+		NodeImpl<Element, dom::Element>::rehome(doc, remap);
+		for (auto& slot : attrs)
+		{
+			slot.name = remap(slot.name);
+			slot.qname = remap(slot.qname);
+			if (slot.node)
+				((NodeImplInit*)slot.node->internalData())->rehome(doc, remap);
+		}
+	}
+
 	void Element::fixQName(bool forElem)
 	{
 		NodeImpl<Element, dom::Element>::fixQName(forElem);
 		if (!forElem) return;
-		for (auto&& pair : lookup)
+		for (auto& slot : attrs)
 		{
-			if (strncmp(pair.first.c_str(), "xmlns", 5) == 0 &&
-				(pair.first.length() == 5 || pair.first[5] == ':'))
+			if (isNamespaceDecl(*slot.name))
+				continue;
+
+			if (slot.node)
 			{
+				NodeImplInit* p = (NodeImplInit*)slot.node->internalData();
+				if (!p) continue;
+				p->fixQName(false);
+				slot.qname = p->qname;
 				continue;
 			}
-			NodeImplInit* p = (NodeImplInit*)pair.second->internalData();
-			if (!p) continue;
-			p->fixQName(false);
+
+			if (slot.nsBound)
+				continue;
+
+			auto& name = *slot.name;
+			auto col = name.find(':');
+			if (col == std::string::npos)
+				continue;
+
+			QName resolved = *slot.qname;
+			fixQName(resolved, name.substr(0, col), name.substr(col + 1));
+			if (resolved != *slot.qname)
+				slot.qname = names->intern(resolved);
 		};
 	}
 
@@ -185,12 +337,12 @@ namespace dom { namespace impl {
 		{
 			nsRebuilt = true;
 			namespaces.clear();
-			for (auto&& pair : lookup)
+			for (auto& slot : attrs)
 			{
-				if (strncmp(pair.first.c_str(), "xmlns", 5) != 0) continue;
-				if (pair.first.length() != 5 && pair.first[5] != ':') continue;
-				if (pair.first.length() == 5) namespaces[""] = pair.second->value();
-				else namespaces[std::string(pair.first.c_str() + 6)] = pair.second->value();
+				auto& name = *slot.name;
+				if (!isNamespaceDecl(name)) continue;
+				if (name.length() == 5) namespaces[""] = slot.get();
+				else namespaces[name.substr(6)] = slot.get();
 			};
 		}
 		InternalNamespaces::const_iterator _it = namespaces.find(ns);
@@ -33,27 +33,71 @@ namespace dom { namespace impl {
 	{
 		typedef std::map< std::string, std::string > InternalNamespaces;
 		InternalNamespaces namespaces;
-		std::map< std::string, dom::AttributePtr > lookup;
+
+		// Attributes are kept as interned name and value pairs, and only
+		// turned into Attribute nodes on request. The node is created once,
+		// under the document's node guard, and never replaced on read. The
+		// slot keeps the value even then: setting it through the node
+		// updates the slot, so reads never have to look at the node.
+		struct AttrSlot
+		{
+			const std::string* name;
+			const QName* qname;
+			bool nsBound;
+			std::string value;
+			dom::AttributePtr node;
+
+			const std::string& get() const { return value; }
+		};
+		std::vector<AttrSlot> attrs;
 		bool nsRebuilt;
+
+		AttrSlot* findSlot(const std::string& name);
+		const dom::AttributePtr& materialize(AttrSlot& slot);
+		bool setSlot(const std::string* name, const QName* qname, bool nsBound, const std::string& value);
 	public:
 		Element(const Init& init);
 
+		size_t attributeCount() const { return attrs.size(); }
+		const std::string* attributeName(size_t index) const { return attrs[index].name; }
+		const QName* attributeQName(size_t index) const { return attrs[index].qname; }
+		std::string attributeValue(size_t index) const { return attrs[index].get(); }
+		bool attributeValueEquals(size_t index, const std::string& value) const
+		{
+			return attrs[index].value == value;
+		}
+		dom::Attribute* attributeNode(size_t index) { return materialize(attrs[index]).get(); }
+		// Called by a materialized Attribute, when its value is set.
+		void attributeChanged(const dom::Attribute* node, const std::string& value);
+
 		std::string getAttribute(const std::string& name) override;
 		dom::AttributePtr getAttributeNode(const std::string& name) override;
 		bool setAttribute(const dom::AttributePtr& attr) override;
 		bool removeAttribute(const AttributePtr& attr) override;
 		bool setAttribute(const std::string& attr, const std::string& value) override;
+		bool setAttributeNS(const std::string& nsName, const std::string& qualifiedName, const std::string& value) override;
 		bool removeAttribute(const std::string& attr) override;
 		dom::NodeListPtr getAttributes() override;
 		bool hasAttribute(const std::string& name) override;
-		void enumTagNames(const std::string& tagName, NodePtrs& out);
+		void enumTagNames(const std::string* tagName, NodePtrs& out);
 		dom::NodeListPtr getElementsByTagName(const std::string& tagName) override;
 		bool appendAttr(const dom::NodePtr& newChild);
 		bool removeAttr(const dom::NodePtr& child);
 		std::string innerText() override;
+		void rehome(const std::shared_ptr<dom::Document>& doc, NameRemap& remap) override;
 		void fixQName(bool forElem = true) override;
 		void fixQName(QName& qname, const std::string& ns, const std::string& localName) override;
 	};
+
+	// Elements with the given interned name, in document order.
+	class TagNameCollector : public Visitor
+	{
+		const std::string* m_tagName;
+		NodePtrs& m_out;
+	public:
+		TagNameCollector(const std::string* tagName, NodePtrs& out) : m_tagName(tagName), m_out(out) {}
+		ACTION onEnter(dom::Node& node) override;
+	};
 }}
 
 #endif // __DOM_INTERNAL_ELEMENT_HPP__
\ No newline at end of file
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2013 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "names.hpp"
+
+namespace dom { namespace impl {
+
+	const std::string* NameTable::intern(const std::string& name)
+	{
+		std::lock_guard<std::mutex> lock(m_guard);
+		return &*m_names.insert(name).first;
+	}
+
+	const QName* NameTable::intern(const QName& qname)
+	{
+		std::lock_guard<std::mutex> lock(m_guard);
+		return &*m_qnames.insert(qname).first;
+	}
+
+	const std::string* NameTable::find(const std::string& name) const
+	{
+		std::lock_guard<std::mutex> lock(m_guard);
+		auto it = m_names.find(name);
+		if (it == m_names.end())
+			return nullptr;
+		return &*it;
+	}
+
+	const QName* NameTable::find(const QName& qname) const
+	{
+		std::lock_guard<std::mutex> lock(m_guard);
+		auto it = m_qnames.find(qname);
+		if (it == m_qnames.end())
+			return nullptr;
+		return &*it;
+	}
+
+	const std::string* NameRemap::operator()(const std::string* name)
+	{
+		auto& mapped = m_names[name];
+		if (!mapped)
+			mapped = m_target->intern(*name);
+		return mapped;
+	}
+
+	const QName* NameRemap::operator()(const QName* qname)
+	{
+		auto& mapped = m_qnames[qname];
+		if (!mapped)
+			mapped = m_target->intern(*qname);
+		return mapped;
+	}
+}}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2013 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DOM_INTERNAL_NAMES_HPP__
+#define __DOM_INTERNAL_NAMES_HPP__
+
+#include <dom/nodes/node.hpp>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace dom { namespace impl {
+
+	struct QNameHash
+	{
+		size_t operator()(const QName& qname) const
+		{
+			std::hash<std::string> hash;
+			return hash(qname.nsName) * 31 + hash(qname.localName);
+		}
+	};
+
+	// Every node name and resolved QName of a document is stored here
+	// exactly once, so nodes keep pointers instead of strings and name
+	// tests compare pointers. Entries are never removed; the addresses
+	// stay valid for as long as the table lives.
+	class NameTable
+	{
+		mutable std::mutex m_guard;
+		std::unordered_set<std::string> m_names;
+		std::unordered_set<QName, QNameHash> m_qnames;
+		size_t m_generation = 0;
+		mutable std::mutex m_nodeGuard;
+	public:
+		const std::string* intern(const std::string& name);
+		const QName* intern(const QName& qname);
+		const QName* intern(const std::string& nsName, const std::string& localName)
+		{
+			return intern(QName{ nsName, localName });
+		}
+
+		// Lookups only; nullptr means no node in the document has
+		// this name, so nothing can match it.
+		const std::string* find(const std::string& name) const;
+		const QName* find(const QName& qname) const;
+
+		// Every node of a document points to its table, which makes the
+		// table the cheapest place to count changes to the document.
+		size_t generation() const { return m_generation; }
+		void touch() { ++m_generation; }
+
+		// Serializes the nodes created on read, like the Attribute
+		// nodes of an element's attribute slots.
+		std::mutex& nodeGuard() const { return m_nodeGuard; }
+	};
+	using NameTablePtr = std::shared_ptr<NameTable>;
+
+	// Translates interned names of one table into another, going to the
+	// target table only once for every distinct name.
+	class NameRemap
+	{
+		NameTablePtr m_target;
+		std::unordered_map<const std::string*, const std::string*> m_names;
+		std::unordered_map<const QName*, const QName*> m_qnames;
+	public:
+		explicit NameRemap(const NameTablePtr& target) : m_target(target) {}
+
+		const NameTablePtr& target() const { return m_target; }
+		const std::string* operator()(const std::string* name);
+		const QName* operator()(const QName* qname);
+	};
+}}
+
+#endif // __DOM_INTERNAL_NAMES_HPP__
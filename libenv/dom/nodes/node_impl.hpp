@@ -29,6 +29,7 @@
 #include <dom/dom.hpp>
 #include <dom/dom_xpath.hpp>
 #include "nodelist.hpp"
+#include "names.hpp"
 
 namespace dom { namespace impl {
 
@@ -53,21 +54,46 @@ namespace dom { namespace impl {
 	struct NodeImplInit
 	{
 		NODE_TYPE type;
-		std::string _name, _value;
+		bool nsBound = false; // created with a namespace, fixQName has nothing to do
+		const std::string* _name = nullptr; // interned in names
+		std::string _value;
 		NodePtrs children;
 		std::weak_ptr<dom::Document> document;
 		std::weak_ptr<dom::Node> parent;
 		size_t index = (size_t)-1;
-		QName qname;
+		const QName* qname = nullptr; // interned in names
+		NameTablePtr names;
+
+		virtual dom::NodePtr self() { return nullptr; }
+
+		// Moves a subtree built by another document over to doc; the
+		// memory of the nodes stays where it was allocated.
+		virtual void rehome(const std::shared_ptr<dom::Document>& doc, NameRemap& remap)
+		{
+			document = doc;
+			names = remap.target();
+			_name = remap(_name);
+			qname = remap(qname);
+			for (auto& child : children)
+				((NodeImplInit*)child->internalData())->rehome(doc, remap);
+		}
 
 		virtual void fixQName(bool forElem = true)
 		{
-			std::string::size_type col = _name.find(':');
+			if (nsBound) return;
+
+			const std::string& name = *_name;
+			std::string::size_type col = name.find(':');
 			if (col == std::string::npos && !forElem) return;
+
+			QName resolved = *qname;
 			if (col == std::string::npos)
-				fixQName(qname, std::string(), _name);
+				fixQName(resolved, std::string(), name);
 			else
-				fixQName(qname, std::string(_name.c_str(), col), std::string(_name.c_str() + col + 1));
+				fixQName(resolved, std::string(name.c_str(), col), std::string(name.c_str() + col + 1));
+
+			if (resolved != *qname)
+				qname = names->intern(resolved);
 		}
 
 		virtual void fixQName(QName& qname, const std::string& ns, const std::string& localName)
@@ -90,16 +116,20 @@ namespace dom { namespace impl {
 
 		NodeImpl(const Init& init) : Init(init)
 		{
-			qname.localName = init._name;
+			if (!qname)
+				qname = names->intern(std::string(), *_name);
 		}
 
-		std::string nodeName() const override { return _name; }
-		const QName& nodeQName() const override { return qname; }
+		std::string nodeName() const override { return *_name; }
+		const QName& nodeQName() const override { return *qname; }
 		std::string nodeValue() const override { return _value; }
 		void nodeValue(const std::string& val) override
 		{
 			if (type != ELEMENT_NODE)
+			{
 				_value = val;
+				names->touch();
+			}
 		}
 
 		NODE_TYPE nodeType() const override { return type; }
@@ -187,6 +217,7 @@ namespace dom { namespace impl {
 			children.insert(it, newChild);
 
 			p->fixQName();
+			names->touch();
 
 			size_t length = children.size();
 			for (size_t i = index; i < length; ++i)
@@ -246,6 +277,8 @@ namespace dom { namespace impl {
 				p->fixQName();
 			}
 
+			names->touch();
+
 			size_t length = this->children.size();
 			for (size_t i = index; i < length; ++i)
 			{
@@ -261,6 +294,18 @@ namespace dom { namespace impl {
 		{
 			return insertBefore(newChild);
 		}
+
+		// Builder path for trees fresh out of a parser: newChild must come
+		// from this node's document, have no parent and already carry its
+		// final name, so there is nothing to detach, resolve or reindex.
+		void appendBuilt(const dom::NodePtr& newChild)
+		{
+			NodeImplInit* p = (NodeImplInit*)newChild->internalData();
+			p->parent = ((T*)this)->shared_from_this();
+			p->index = children.size();
+			children.push_back(newChild);
+			names->touch();
+		}
 		bool replaceChild(const NodePtr& newChild, const NodePtr& oldChild) override
 		{
 			if (!oldChild)
@@ -301,6 +346,7 @@ namespace dom { namespace impl {
 			auto it = children.begin();
 			std::advance(it, index);
 			children.erase(it);
+			names->touch();
 			size_t length = children.size();
 			for (size_t i = index; i < length; ++i)
 			{
@@ -313,17 +359,28 @@ namespace dom { namespace impl {
 		}
 
 		void* internalData() override { return (NodeImplInit*)this; }
+		dom::NodePtr self() override { return ((T*)this)->shared_from_this(); }
 
 		bool appendAttr(const dom::NodePtr& newChild) { return false; }
 		bool removeAttr(const dom::NodePtr& child) { return false; }
 
 		NodePtr find(const std::string& path, const Namespaces& ns) override
 		{
-			return xpath::XPath(path, ns).find(((T*)this)->shared_from_this());
+			auto query = xpath::cached(path, ns);
+			if (!query) return nullptr;
+			return query->find(((T*)this)->shared_from_this());
 		}
 		NodeListPtr findall(const std::string& path, const Namespaces& ns) override
 		{
-			return xpath::XPath(path, ns).findall(((T*)this)->shared_from_this());
+			auto query = xpath::cached(path, ns);
+			if (!query) return nullptr;
+			return query->findall(((T*)this)->shared_from_this());
+		}
+		NodeListPtr findall(const std::string& path, const Namespaces& ns, size_t limit) override
+		{
+			auto query = xpath::cached(path, ns);
+			if (!query) return nullptr;
+			return query->findall(((T*)this)->shared_from_this(), limit);
 		}
 	};
 
@@ -26,13 +26,42 @@
 #define __DOM_INTERNAL_TEXT_HPP__
 
 #include <dom/nodes/document.hpp>
+#include <env/string_ref.hpp>
 
 namespace dom { namespace impl {
 
 	class Text : public ChildNodeImpl<Text, dom::Text>
 	{
+		// Text of documents with an arena lives in the arena, next to the
+		// node, and is only turned into a string when asked for. Setting
+		// the value switches the node back to the owned _value.
+		const char* m_data = nullptr;
+		size_t m_size = 0;
 	public:
 		Text(const Init& init) : ChildNodeImpl(init) {}
+		Text(const Init& init, const char* data, size_t size) : ChildNodeImpl(init), m_data(data), m_size(size) {}
+
+		std::string nodeValue() const override
+		{
+			if (m_data)
+				return std::string(m_data, m_size);
+			return _value;
+		}
+
+		env::string_ref text() const
+		{
+			if (m_data)
+				return { m_data, m_size };
+			return _value;
+		}
+
+		void nodeValue(const std::string& val) override
+		{
+			m_data = nullptr;
+			m_size = 0;
+			_value = val;
+			names->touch();
+		}
 	};
 }}
 
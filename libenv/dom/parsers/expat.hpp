@@ -3,11 +3,46 @@
 
 #include <expat.h>
 #include <string.h>
+#include <env/string_ref.hpp>
 
 #define USER_DATA static_cast<Final*>(userData)
 
 namespace xml
 {
+	// Separator to create the parser with; together with enableNSTriplets,
+	// expat reports names as "uri<SEP>local<SEP>prefix", leaving out
+	// the parts, which are not there.
+	static constexpr XML_Char NS_SEPARATOR = '\x01';
+
+	struct NSName
+	{
+		env::string_ref nsName;
+		env::string_ref localName;
+		env::string_ref prefix;
+	};
+
+	static inline NSName splitNSName(const XML_Char* name)
+	{
+		NSName out;
+		auto sep = strchr(name, NS_SEPARATOR);
+		if (!sep) {
+			out.localName = name;
+			return out;
+		}
+
+		out.nsName = { name, (size_t)(sep - name) };
+		auto local = sep + 1;
+		sep = strchr(local, NS_SEPARATOR);
+		if (!sep) {
+			out.localName = local;
+			return out;
+		}
+
+		out.localName = { local, (size_t)(sep - local) };
+		out.prefix = sep + 1;
+		return out;
+	}
+
 	template <class Final>
 	class ExpatBase
 	{
@@ -50,12 +85,23 @@ namespace xml
 			m_parser = nullptr;
 		}
 
-		bool parse(const char* buffer, int length = -1, bool isFinal = true)
+		bool parse(const char* buffer)
+		{
+			return parse(buffer, strlen(buffer));
+		}
+		bool parse(const char* buffer, size_t length, bool isFinal = true)
 		{
-			if (length < 0)
-				length = strlen(buffer);
+			// XML_Parse takes an int length; larger inputs go in pieces
+			static constexpr size_t max_chunk = 1 << 30;
+			while (length > max_chunk)
+			{
+				if (XML_Parse(m_parser, buffer, (int)max_chunk, XML_FALSE) != XML_STATUS_OK)
+					return false;
+				buffer += max_chunk;
+				length -= max_chunk;
+			}
 
-			return XML_Parse(m_parser, buffer, length, isFinal) != 0;
+			return XML_Parse(m_parser, buffer, (int)length, isFinal) != 0;
 		}
 		bool parseBuffer(int length, bool isFinal = true)
 		{
@@ -65,6 +111,14 @@ namespace xml
 		{
 			return XML_GetBuffer(m_parser, length);
 		}
+		bool stopParser(bool resumable = false)
+		{
+			return XML_StopParser(m_parser, resumable ? XML_TRUE : XML_FALSE) == XML_STATUS_OK;
+		}
+		void enableNSTriplets(bool enable = true)
+		{
+			XML_SetReturnNSTriplet(m_parser, enable ? XML_TRUE : XML_FALSE);
+		}
 		void enableStartElementHandler(bool enable = true)
 		{
 			XML_SetStartElementHandler(m_parser, enable ? startElementHandler : nullptr);
@@ -23,51 +23,99 @@
  */
 
 #include <dom/parsers/parser.hpp>
-namespace dom { namespace parsers {
+#include <env/utf8.hpp>
+#include <chrono>
+#include <memory>
 
-#if 0
-	DocumentPtr parseFile(const ParserPtr& parser, const filesystem::path& path)
-	{
-		if (!parser)
-			return nullptr;
+namespace dom { namespace parsers {
 
-		FILE* f = fopen(path.native().c_str(), "rb");
-		if (!f)
-			return nullptr;
+	static constexpr size_t chunk_size = 256 * 1024;
 
+	static bool feedFile(const ParserPtr& parser, FILE* file, uint64_t& total)
+	{
 		if (!parser->supportsChunks())
 		{
-			size_t length = filesystem::file_size(path);
-			char * contents = (char*)malloc(length);
-			if (!contents)
-				return nullptr;
+			std::string contents;
+			char buffer[8192];
+			size_t read;
+			while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+				contents.append(buffer, read);
 
-			size_t read = fread(contents, 1, length, f);
-			fclose(f);
+			total = contents.size();
+			return !ferror(file) && parser->onData(contents.data(), contents.size());
+		}
 
-			if (!parser->onData(contents, length))
+		if (parser->supportsBuffers())
+		{
+			while (true)
 			{
-				free(contents);
-				return nullptr;
+				void* buffer = parser->getBuffer(chunk_size);
+				if (!buffer)
+					return false;
+
+				size_t read = fread(buffer, 1, chunk_size, file);
+				if (!read)
+					break;
+
+				total += read;
+				if (!parser->onBuffer(read))
+					return false;
 			}
 
-			free(contents);
-			return parser->onFinish();
+			return !ferror(file);
 		}
 
-		char buffer[8192];
+		std::unique_ptr<char[]> buffer{ new (std::nothrow) char[chunk_size] };
+		if (!buffer)
+			return false;
+
 		size_t read;
-		while ((read = fread(buffer, 1, sizeof(buffer), f)) > 0)
+		while ((read = fread(buffer.get(), 1, chunk_size, file)) > 0)
 		{
-			if (!parser->onData(buffer, read))
-			{
-				fclose(f);
-				return nullptr;
-			}
+			total += read;
+			if (!parser->onData(buffer.get(), read))
+				return false;
 		}
-		fclose(f);
 
-		return parser->onFinish();
+		return !ferror(file);
 	}
+
+	DocumentPtr parseFile(const ParserPtr& parser, FILE* file, ParseStats* stats)
+	{
+		if (!parser || !file)
+			return nullptr;
+
+		auto start = std::chrono::steady_clock::now();
+		uint64_t total = 0;
+
+		DocumentPtr doc;
+		try {
+			if (feedFile(parser, file, total))
+				doc = parser->onFinish();
+		}
+		catch (std::bad_alloc) {}
+
+		if (stats)
+		{
+			stats->bytes = total;
+			stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		return doc;
+	}
+
+	DocumentPtr parseFile(const ParserPtr& parser, const std::string& path, ParseStats* stats)
+	{
+#ifdef WIN32
+		FILE* file = _wfopen(utf::widen(path).c_str(), L"rb");
+#else
+		FILE* file = fopen(path.c_str(), "rb");
 #endif
+		if (!file)
+			return nullptr;
+
+		auto doc = parseFile(parser, file, stats);
+		fclose(file);
+		return doc;
+	}
 }}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2015 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <dom/parsers/sax.hpp>
+#include <vector>
+#include "expat.hpp"
+
+namespace dom { namespace parsers { namespace sax {
+
+	static Name splitName(const XML_Char* name)
+	{
+		auto split = ::xml::splitNSName(name);
+		return { split.nsName, split.localName, split.prefix };
+	}
+
+	class SaxParser : public sax::Parser, public ::xml::ExpatBase<SaxParser>
+	{
+		Handler& m_handler;
+		std::vector<Attribute> m_attrs;
+		bool m_stopped = false;
+	public:
+		explicit SaxParser(Handler& handler) : m_handler(handler) {}
+
+		bool create(const std::string& cp)
+		{
+			static const XML_Char separator[] = { ::xml::NS_SEPARATOR, 0 };
+			if (!::xml::ExpatBase<SaxParser>::create(cp.empty() ? nullptr : cp.c_str(), separator))
+				return false;
+
+			enableNSTriplets();
+			enableElementHandler();
+			enableCharacterDataHandler();
+			enableNamespaceDeclHandler();
+			return true;
+		}
+
+		bool onData(const void* data, size_t length) override
+		{
+			return parse((const char*)data, length, false);
+		}
+
+		bool onFinish() override
+		{
+			return parse(nullptr, 0);
+		}
+
+		void stop() override
+		{
+			m_stopped = true;
+			stopParser();
+		}
+
+		bool stopped() const override { return m_stopped; }
+
+		std::string errorMessage() const override
+		{
+			auto thiz = const_cast<SaxParser*>(this);
+			return std::to_string(line()) + ":" + std::to_string(column()) + ": " + thiz->getErrorString();
+		}
+
+		size_t line() const override { return const_cast<SaxParser*>(this)->getCurrentLineNumber(); }
+		size_t column() const override { return const_cast<SaxParser*>(this)->getCurrentColumnNumber(); }
+
+		void onStartNamespaceDecl(const XML_Char* prefix, const XML_Char* uri)
+		{
+			m_handler.onStartNamespace(prefix, uri);
+		}
+
+		void onEndNamespaceDecl(const XML_Char* prefix)
+		{
+			m_handler.onEndNamespace(prefix);
+		}
+
+		void onStartElement(const XML_Char* name, const XML_Char** attrs)
+		{
+			m_attrs.clear();
+			for (; *attrs; attrs += 2)
+				m_attrs.push_back({ splitName(attrs[0]), attrs[1] });
+
+			m_handler.onStartElement(splitName(name), { m_attrs.data(), m_attrs.size() });
+		}
+
+		void onEndElement(const XML_Char* name)
+		{
+			m_handler.onEndElement(splitName(name));
+		}
+
+		void onCharacterData(const XML_Char* data, int length)
+		{
+			m_handler.onText({ data, (size_t)length });
+		}
+	};
+
+	ParserPtr create(Handler& handler, const std::string& encoding)
+	{
+		try
+		{
+			auto parser = std::make_shared<SaxParser>(handler);
+			if (!parser->create(encoding))
+				return nullptr;
+
+			return parser;
+		}
+		catch (std::bad_alloc&)
+		{
+			return nullptr;
+		}
+	}
+}}}
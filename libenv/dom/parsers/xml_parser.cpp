@@ -24,32 +24,53 @@
 
 #include <dom/parsers/xml.hpp>
 #include <dom/dom.hpp>
+#include <vector>
 #include "expat.hpp"
+#include "../nodes/document.hpp"
+#include "../nodes/element.hpp"
 
 namespace dom { namespace parsers { namespace xml {
 
 	class Parser : public parsers::Parser, public ::xml::ExpatBase<Parser>
 	{
-		dom::ElementPtr elem;
+		// The tree is only reachable through the parser until it is done,
+		// so nodes go in through the trusted builder path; the stack keeps
+		// the open elements, owned by the root.
+		std::vector<impl::Element*> stack;
 		std::string text;
 		dom::DocumentPtr doc;
+		impl::Document* builder;
+		std::vector<std::pair<std::string, std::string>> nsDecls;
 
 		void addText()
 		{
 			if (text.empty()) return;
-			if (elem)
-				elem->appendChild(doc->createTextNode(text));
+			if (!stack.empty())
+			{
+				auto node = builder->createTextNode(text.data(), text.size());
+				if (node)
+					stack.back()->appendBuilt(node);
+			}
 			text.clear();
 		}
 	public:
 
-		Parser() : doc(dom::Document::create()) {}
+		Parser()
+			: doc(dom::Document::createWithArena())
+			, builder(static_cast<impl::Document*>(doc.get()))
+		{
+		}
 
 		bool create(const std::string& cp)
 		{
 			if (!doc)
 				return false;
-			return ::xml::ExpatBase<Parser>::create(cp.empty() ? nullptr : cp.c_str());
+			static const XML_Char separator[] = { ::xml::NS_SEPARATOR, 0 };
+			if (!::xml::ExpatBase<Parser>::create(cp.empty() ? nullptr : cp.c_str(), separator))
+				return false;
+
+			enableNSTriplets();
+			return true;
 		}
 
 		bool supportsChunks() const override { return true; }
@@ -57,6 +78,15 @@ namespace dom { namespace parsers { namespace xml {
 		{
 			return parse((const char*)data, length, false);
 		}
+		bool supportsBuffers() const override { return true; }
+		void* getBuffer(size_t length) override
+		{
+			return ::xml::ExpatBase<Parser>::getBuffer((int)length);
+		}
+		bool onBuffer(size_t length) override
+		{
+			return parseBuffer((int)length, false);
+		}
 		DocumentPtr onFinish() override
 		{
 			if (!parse(nullptr, 0))
@@ -74,35 +104,58 @@ namespace dom { namespace parsers { namespace xml {
 			return false;
 		}
 
+		static std::string qualifiedName(const ::xml::NSName& name)
+		{
+			if (name.prefix.empty())
+				return name.localName.str();
+
+			std::string out;
+			out.reserve(name.prefix.length() + name.localName.length() + 1);
+			name.prefix.append_to(out);
+			out.push_back(':');
+			name.localName.append_to(out);
+			return out;
+		}
+
+		// Expat does not report the xmlns attributes themselves; they are
+		// recreated from the declarations, so that the document stays
+		// complete for later lookups and for printing.
+		void onStartNamespaceDecl(const XML_Char* prefix, const XML_Char* uri)
+		{
+			nsDecls.emplace_back(prefix ? std::string("xmlns:") + prefix : std::string("xmlns"), uri ? uri : "");
+		}
+
 		void onStartElement(const XML_Char *name, const XML_Char **attrs)
 		{
 			addText();
-			auto current = doc->createElement(name);
+			auto qname = ::xml::splitNSName(name);
+			auto current = doc->createElementNS(qname.nsName.str(), qualifiedName(qname));
 			if (!current) return;
+			for (auto& decl : nsDecls)
+				current->setAttribute(decl.first, decl.second);
+			nsDecls.clear();
 			for (; *attrs; attrs += 2)
 			{
-				auto attr = doc->createAttribute(attrs[0], attrs[1]);
-				if (!attr) continue;
-				current->setAttribute(attr);
+				auto qname = ::xml::splitNSName(attrs[0]);
+				current->setAttributeNS(qname.nsName.str(), qualifiedName(qname), attrs[1]);
 			}
-			if (elem)
-				elem->appendChild(current);
+			if (!stack.empty())
+				stack.back()->appendBuilt(current);
 			else
-				doc->setDocumentElement(current);
-			elem = current;
+				builder->adoptDocumentElement(current);
+			stack.push_back(static_cast<impl::Element*>(current.get()));
 		}
 
 		void onEndElement(const XML_Char *name)
 		{
 			addText();
-			if (!elem) return;
-			dom::NodePtr node = elem->parentNode();
-			elem = std::static_pointer_cast<dom::Element>(node);
+			if (!stack.empty())
+				stack.pop_back();
 		}
 
 		void onCharacterData(const XML_Char *pszData, int nLength)
 		{
-			text += std::string(pszData, nLength);
+			text.append(pszData, nLength);
 		}
 	};
 
@@ -115,6 +168,7 @@ namespace dom { namespace parsers { namespace xml {
 				return nullptr;
 
 			parser->enableElementHandler();
+			parser->enableStartNamespaceDeclHandler();
 			parser->enableCharacterDataHandler();
 			parser->enableUnknownEncodingHandler();
 
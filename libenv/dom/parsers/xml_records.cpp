@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2013 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <dom/parsers/xml.hpp>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include "../nodes/document.hpp"
+#include "../nodes/element.hpp"
+
+namespace dom { namespace parsers { namespace xml {
+
+	namespace {
+		static constexpr size_t min_slice = 1024 * 1024;
+
+		static inline bool isNameEnd(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '>' || c == '/';
+		}
+
+		static size_t skipPast(const char* data, size_t pos, size_t size, const char* marker)
+		{
+			size_t len = strlen(marker);
+			while (pos + len <= size)
+			{
+				if (!memcmp(data + pos, marker, len))
+					return pos + len;
+				++pos;
+			}
+			return size;
+		}
+
+		// Finds the end of the root's start tag and builds its end tag.
+		// Anything the scanner is not sure about (internal DTD subsets,
+		// an empty root) is reported as not splittable.
+		static bool findRoot(const char* data, size_t size, size_t& body, std::string& closeTag)
+		{
+			size_t pos = 0;
+			while (true)
+			{
+				auto lt = (const char*)memchr(data + pos, '<', size - pos);
+				if (!lt || lt + 1 == data + size)
+					return false;
+				pos = lt - data;
+
+				if (data[pos + 1] == '?')
+				{
+					pos = skipPast(data, pos, size, "?>");
+					continue;
+				}
+
+				if (data[pos + 1] == '!')
+				{
+					if (size - pos > 4 && !memcmp(data + pos, "<!--", 4))
+					{
+						pos = skipPast(data, pos, size, "-->");
+						continue;
+					}
+
+					size_t end = pos;
+					while (end < size && data[end] != '>' && data[end] != '[')
+						++end;
+					if (end == size || data[end] == '[')
+						return false;
+					pos = end + 1;
+					continue;
+				}
+
+				break;
+			}
+
+			size_t name = pos + 1;
+			size_t end = name;
+			while (end < size && !isNameEnd(data[end]))
+				++end;
+			if (end == name || end == size)
+				return false;
+			size_t nameLength = end - name;
+
+			char quote = 0;
+			for (; end < size; ++end)
+			{
+				char c = data[end];
+				if (quote)
+				{
+					if (c == quote)
+						quote = 0;
+				}
+				else if (c == '"' || c == '\'')
+					quote = c;
+				else if (c == '>')
+					break;
+			}
+
+			if (end == size || data[end - 1] == '/')
+				return false;
+
+			body = end + 1;
+			closeTag = "</" + std::string(data + name, nameLength) + ">";
+			return true;
+		}
+
+		static size_t findRecord(const char* data, size_t pos, size_t size, const std::string& tag)
+		{
+			while (pos < size)
+			{
+				auto lt = (const char*)memchr(data + pos, '<', size - pos);
+				if (!lt)
+					return size;
+				pos = lt - data;
+				size_t next = pos + 1 + tag.length();
+				if (next < size && !memcmp(data + pos + 1, tag.c_str(), tag.length()) && isNameEnd(data[next]))
+					return pos;
+				++pos;
+			}
+			return size;
+		}
+
+		struct Slice
+		{
+			const char* data;
+			size_t size;
+			bool last;
+			DocumentPtr doc;
+		};
+	}
+
+	DocumentPtr parseRecords(const std::string& encoding, const void* data, size_t size, const std::string& recordTag, size_t threads)
+	{
+		auto text = (const char*)data;
+
+		if (!threads)
+			threads = std::thread::hardware_concurrency();
+		if (threads > size / min_slice)
+			threads = size / min_slice;
+
+		if (threads < 2 || recordTag.empty())
+			return parseDocument(encoding, data, size);
+
+		size_t body;
+		std::string closeTag;
+		std::vector<Slice> slices;
+		try {
+			if (!findRoot(text, size, body, closeTag))
+				return parseDocument(encoding, data, size);
+
+			size_t start = body;
+			for (size_t i = 1; i < threads; ++i)
+			{
+				size_t target = size / threads * i;
+				if (target <= start)
+					target = start + 1;
+				size_t next = findRecord(text, target, size, recordTag);
+				if (next == size)
+					break;
+				slices.push_back({ text + start, next - start, false, nullptr });
+				start = next;
+			}
+			slices.push_back({ text + start, size - start, true, nullptr });
+		}
+		catch (std::bad_alloc) { return nullptr; }
+
+		if (slices.size() < 2)
+			return parseDocument(encoding, data, size);
+
+		// The joined document is the root alone; every slice is parsed
+		// inside a copy of the same start tag, so namespaces resolve the
+		// same way, and its nodes are moved over to the joined document
+		// and its name table once the slice is done.
+		auto parser = create(encoding);
+		if (!parser || !parser->onData(text, body) || !parser->onData(closeTag.c_str(), closeTag.length()))
+			return parseDocument(encoding, data, size);
+		auto joined = parser->onFinish();
+		if (!joined || !joined->documentElement())
+			return parseDocument(encoding, data, size);
+
+		auto names = static_cast<impl::Document*>(joined.get())->names();
+
+		auto work = [&](Slice& slice) {
+			try {
+				auto parser = create(encoding);
+				if (!parser ||
+					!parser->onData(text, body) ||
+					!parser->onData(slice.data, slice.size) ||
+					(!slice.last && !parser->onData(closeTag.c_str(), closeTag.length())))
+					return;
+
+				auto part = parser->onFinish();
+				if (!part || !part->documentElement())
+					return;
+
+				impl::NameRemap remap{ names };
+				auto root = (impl::NodeImplInit*)part->documentElement()->internalData();
+				for (auto& child : root->children)
+					((impl::NodeImplInit*)child->internalData())->rehome(joined, remap);
+
+				slice.doc = part;
+			}
+			catch (std::bad_alloc) {}
+		};
+
+		std::vector<std::thread> workers;
+		try {
+			workers.reserve(slices.size() - 1);
+			for (size_t i = 1; i < slices.size(); ++i)
+				workers.emplace_back(work, std::ref(slices[i]));
+		}
+		catch (...) {}
+
+		work(slices[0]);
+		for (size_t i = workers.size() + 1; i < slices.size(); ++i)
+			work(slices[i]); // threads that did not start
+		for (auto& worker : workers)
+			worker.join();
+
+		for (auto& slice : slices)
+		{
+			if (!slice.doc)
+				return parseDocument(encoding, data, size);
+		}
+
+		auto root = static_cast<impl::Element*>(joined->documentElement().get());
+		for (auto& slice : slices)
+		{
+			auto part = (impl::NodeImplInit*)slice.doc->documentElement()->internalData();
+			for (auto& child : part->children)
+				root->appendBuilt(child);
+		}
+
+		return joined;
+	}
+
+}}}
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2013 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <dom/parsers/xml_writer.hpp>
+#include <dom/dom.hpp>
+#include <string.h>
+#include "../nodes/element.hpp"
+#include "../nodes/text.hpp"
+
+namespace dom { namespace parsers { namespace xml {
+
+	Writer::Writer(OutStream& out, size_t bufferSize)
+		: m_out(out)
+		, m_buffer(bufferSize ? bufferSize : default_buffer)
+	{
+	}
+
+	Writer::~Writer()
+	{
+		flush();
+	}
+
+	void Writer::flush()
+	{
+		if (m_used)
+			m_out.puts(m_buffer.data(), m_used);
+		m_used = 0;
+	}
+
+	void Writer::append(const char* data, size_t length)
+	{
+		if (length > m_buffer.size() - m_used)
+		{
+			flush();
+			if (length >= m_buffer.size())
+			{
+				m_out.puts(data, length);
+				return;
+			}
+		}
+
+		memcpy(m_buffer.data() + m_used, data, length);
+		m_used += length;
+	}
+
+	// Characters, which need an entity: 1 in text and attribute values,
+	// 2 in attribute values only.
+	static const unsigned char escapes[256] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 0, 0, 1, 0, 0, // \t \n \r
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, // " &
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, // < >
+	};
+
+	static inline const char* entity(char c)
+	{
+		switch (c)
+		{
+		case '&': return "&amp;";
+		case '<': return "&lt;";
+		case '>': return "&gt;";
+		case '"': return "&quot;";
+		case '\t': return "&#9;";
+		case '\n': return "&#10;";
+		case '\r': return "&#13;";
+		}
+		return "";
+	}
+
+	// Runs of characters, which need no escaping, are copied in one go.
+	void Writer::escape(env::string_ref data, bool attr)
+	{
+		auto ptr = data.begin();
+		auto end = data.end();
+		auto run = ptr;
+		unsigned char mask = attr ? 3 : 1;
+		for (; ptr != end; ++ptr)
+		{
+			if (!(escapes[(unsigned char)*ptr] & mask))
+				continue;
+
+			append(run, ptr - run);
+			append(entity(*ptr));
+			run = ptr + 1;
+		}
+		append(run, end - run);
+	}
+
+	void Writer::closeStart()
+	{
+		if (!m_startOpen)
+			return;
+		append(">", 1);
+		m_startOpen = false;
+	}
+
+	std::string& Writer::push()
+	{
+		if (m_depth == m_stack.size())
+			m_stack.emplace_back();
+		return m_stack[m_depth++];
+	}
+
+	void Writer::declaration()
+	{
+		append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+	}
+
+	void Writer::startElement(env::string_ref qualifiedName)
+	{
+		closeStart();
+		auto& name = push();
+		name.assign(qualifiedName.data(), qualifiedName.size());
+		append("<", 1);
+		append(qualifiedName);
+		m_startOpen = true;
+	}
+
+	void Writer::attribute(env::string_ref prefix, env::string_ref localName, env::string_ref value)
+	{
+		if (!m_startOpen)
+			return;
+
+		append(" ", 1);
+		if (!prefix.empty())
+		{
+			append(prefix);
+			append(":", 1);
+		}
+		append(localName);
+		append("=\"", 2);
+		escape(value, true);
+		append("\"", 1);
+	}
+
+	void Writer::attribute(env::string_ref qualifiedName, env::string_ref value)
+	{
+		attribute({ }, qualifiedName, value);
+	}
+
+	void Writer::endElement()
+	{
+		if (!m_depth)
+			return;
+
+		auto& name = m_stack[--m_depth];
+		if (m_startOpen)
+		{
+			append("/>", 2);
+			m_startOpen = false;
+			return;
+		}
+
+		append("</", 2);
+		append(name);
+		append(">", 1);
+	}
+
+	void Writer::text(env::string_ref data)
+	{
+		if (data.empty())
+			return;
+		closeStart();
+		escape(data, false);
+	}
+
+	class NodeWriter : public Visitor
+	{
+		Writer& m_out;
+	public:
+		explicit NodeWriter(Writer& out) : m_out(out) {}
+
+		ACTION onEnter(Node& node) override
+		{
+			switch (node.nodeType())
+			{
+			case ELEMENT_NODE:
+			{
+				auto elem = static_cast<impl::Element*>(static_cast<Element*>(&node));
+				m_out.startElement(*((impl::NodeImplInit*)elem)->_name);
+				auto count = elem->attributeCount();
+				for (size_t i = 0; i < count; ++i)
+					m_out.attribute(*elem->attributeName(i), elem->attributeValue(i));
+				return CONTINUE;
+			}
+			case TEXT_NODE:
+				m_out.text(static_cast<impl::Text*>(static_cast<Text*>(&node))->text());
+				return SKIP;
+			case ATTRIBUTE_NODE:
+				return SKIP;
+			default:
+				return CONTINUE;
+			}
+		}
+
+		bool onLeave(Node& node) override
+		{
+			if (node.nodeType() == ELEMENT_NODE)
+				m_out.endElement();
+			return true;
+		}
+	};
+
+	void Writer::write(Node& node)
+	{
+		NodeWriter writer(*this);
+		walk(node, writer);
+	}
+
+	void Writer::onStartNamespace(env::string_ref prefix, env::string_ref uri)
+	{
+		m_nsDecls.emplace_back(prefix.str(), uri.str());
+	}
+
+	void Writer::onStartElement(const sax::Name& name, const sax::Attributes& attrs)
+	{
+		closeStart();
+		auto& qname = push();
+		qname.clear();
+		if (!name.prefix.empty())
+		{
+			name.prefix.append_to(qname);
+			qname.push_back(':');
+		}
+		name.localName.append_to(qname);
+
+		append("<", 1);
+		append(qname);
+		m_startOpen = true;
+
+		for (auto& decl : m_nsDecls)
+			attribute(decl.first.empty() ? env::string_ref() : env::string_ref("xmlns"), decl.first.empty() ? env::string_ref("xmlns") : env::string_ref(decl.first), decl.second);
+		m_nsDecls.clear();
+
+		for (auto& attr : attrs)
+			attribute(attr.name.prefix, attr.name.localName, attr.value);
+	}
+
+	void Writer::onEndElement(const sax::Name&)
+	{
+		endElement();
+	}
+
+	void Writer::onText(env::string_ref data)
+	{
+		text(data);
+	}
+}}}
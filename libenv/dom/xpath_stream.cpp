@@ -0,0 +1,419 @@
+/*
+ * Copyright (C) 2013 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <dom/xpath_stream.hpp>
+#include <algorithm>
+
+namespace dom { namespace xpath {
+
+	using parsers::sax::Name;
+	using parsers::sax::Attributes;
+
+	static bool like(const Name& name, const QName& tmplt)
+	{
+		if (tmplt.nsName.empty() && tmplt.localName.empty())
+			return true;
+		if (tmplt.nsName != "*" && name.nsName != tmplt.nsName)
+			return false;
+		if (tmplt.localName != "*" && name.localName != tmplt.localName)
+			return false;
+		return true;
+	}
+
+	static std::string qualifiedName(const Name& name)
+	{
+		if (name.prefix.empty())
+			return name.localName.str();
+		return name.prefix.str() + ":" + name.localName.str();
+	}
+
+	struct AttrTest
+	{
+		QName name;
+		bool equals;
+		std::string value;
+
+		bool test(const Attributes& attrs) const
+		{
+			for (auto& attr : attrs)
+			{
+				if (!like(attr.name, name))
+					continue;
+				if (!equals || attr.value == value)
+					return true;
+			}
+			return false;
+		}
+	};
+
+	struct Step
+	{
+		QName name;
+		bool descendant = false;   // preceded by '//'
+		std::vector<AttrTest> attrs;
+		bool buffered = false;     // has predicates, which need the subtree
+		Segments remainder;        // this step, on the self axis, and the rest of the path
+
+		bool test(const Name& elem, const Attributes& list) const
+		{
+			if (!like(elem, name))
+				return false;
+			for (auto& attr : attrs)
+			{
+				if (!attr.test(list))
+					return false;
+			}
+			return true;
+		}
+	};
+
+	enum TARGET
+	{
+		TARGET_ELEMENT,
+		TARGET_ATTRIBUTE,
+		TARGET_TEXT
+	};
+
+	struct StreamMatcher::Query
+	{
+		std::vector<Step> steps;
+		TARGET target = TARGET_ELEMENT;
+		QName attrName;
+		Callback callback;
+		// states (number of steps already matched) active for
+		// the children of each open element
+		std::vector<std::vector<size_t>> stack;
+	};
+
+	struct StreamMatcher::Capture
+	{
+		CAPTURE kind;
+		const Query* query;
+		size_t step;
+		size_t depth;
+		DocumentPtr doc;
+		ElementPtr root;
+		std::vector<ElementPtr> open;
+		std::string text;
+
+		void flushText(const DocumentPtr& scratch)
+		{
+			if (text.empty())
+				return;
+
+			if (kind == CAPTURE_TEXT)
+			{
+				auto node = scratch->createTextNode(text);
+				if (node)
+					query->callback(node);
+			}
+			else if (!open.empty())
+			{
+				auto node = doc->createTextNode(text);
+				if (node)
+					open.back()->appendChild(node);
+			}
+			text.clear();
+		}
+
+		ElementPtr createElement(const Name& name, const Attributes& attrs)
+		{
+			auto elem = doc->createElementNS(name.nsName.str(), qualifiedName(name));
+			if (!elem)
+				return nullptr;
+
+			for (auto& attr : attrs)
+				elem->setAttributeNS(attr.name.nsName.str(), qualifiedName(attr.name), attr.value.str());
+			return elem;
+		}
+	};
+
+	static bool isDescendantOrSelf(const Segment& seg)
+	{
+		return seg.m_selector.m_axis == AXIS_DESCENDANT_OR_SELF &&
+			seg.m_selector.m_test == TEST_NODE &&
+			seg.m_preds.empty();
+	}
+
+	static bool compileStep(const Segment& seg, Step& step)
+	{
+		if (seg.m_selector.m_axis != AXIS_CHILD || seg.m_selector.m_test != TEST_ELEMENT)
+			return false;
+
+		step.name = seg.m_selector.m_name;
+		for (auto& pred : seg.m_preds)
+		{
+			if (pred.m_selectors.size() == 1)
+			{
+				auto& sel = pred.m_selectors.front();
+				if (sel.m_axis == AXIS_ATTRIBUTE && sel.m_test == TEST_ATTRIBUTE)
+				{
+					step.attrs.push_back({ sel.m_name, pred.m_type == PRED_EQUALS, pred.m_value });
+					continue;
+				}
+			}
+			step.buffered = true;
+		}
+		return true;
+	}
+
+	StreamMatcher::StreamMatcher()
+		: m_scratch(Document::create())
+	{
+	}
+
+	StreamMatcher::~StreamMatcher()
+	{
+	}
+
+	bool StreamMatcher::add(const XPathPtr& xpath, const Callback& callback)
+	{
+		if (!xpath || !callback)
+			return false;
+
+		auto& segments = xpath->m_segments;
+		auto it = segments.begin();
+		auto end = segments.end();
+
+		// relative paths start at the document anyway
+		if (it != end && it->m_selector.m_axis == AXIS_SELF && it->m_selector.m_test == TEST_DOCUMENT_NODE && it->m_preds.empty())
+			++it;
+
+		try {
+			std::unique_ptr<Query> query{ new Query };
+			query->callback = callback;
+
+			bool descendant = false;
+			for (; it != end; ++it)
+			{
+				if (isDescendantOrSelf(*it))
+				{
+					descendant = true;
+					continue;
+				}
+
+				auto& sel = it->m_selector;
+				auto next = it;
+				++next;
+				if (next == end && it->m_preds.empty() && !descendant)
+				{
+					if (sel.m_axis == AXIS_ATTRIBUTE && sel.m_test == TEST_ATTRIBUTE)
+					{
+						query->target = TARGET_ATTRIBUTE;
+						query->attrName = sel.m_name;
+						break;
+					}
+					if (sel.m_axis == AXIS_CHILD && sel.m_test == TEST_TEXT)
+					{
+						query->target = TARGET_TEXT;
+						break;
+					}
+				}
+
+				Step step;
+				if (!compileStep(*it, step))
+					return false;
+				step.descendant = descendant;
+				descendant = false;
+
+				if (step.buffered)
+				{
+					step.remainder.assign(it, end);
+					step.remainder.front().m_selector.m_axis = AXIS_SELF;
+				}
+
+				bool buffered = step.buffered;
+				query->steps.push_back(std::move(step));
+				if (buffered)
+					break;
+			}
+
+			if (descendant || query->steps.empty())
+				return false;
+
+			query->stack.push_back({ 0 });
+			m_queries.push_back(std::move(query));
+			return true;
+		}
+		catch (std::bad_alloc) { return false; }
+	}
+
+	void StreamMatcher::startCapture(CAPTURE kind, const Query& query, size_t step, const Name& name, const Attributes& attrs)
+	{
+		std::unique_ptr<Capture> capture{ new Capture };
+		capture->kind = kind;
+		capture->query = &query;
+		capture->step = step;
+		capture->depth = m_depth;
+
+		if (kind != CAPTURE_TEXT)
+		{
+			capture->doc = m_scratch;
+			capture->root = capture->createElement(name, attrs);
+			if (!capture->root)
+				return;
+			capture->open.push_back(capture->root);
+		}
+
+		m_captures.push_back(std::move(capture));
+	}
+
+	void StreamMatcher::onStartElement(const Name& name, const Attributes& attrs)
+	{
+		for (auto& capture : m_captures)
+		{
+			capture->flushText(m_scratch);
+			if (capture->kind == CAPTURE_TEXT)
+				continue;
+
+			auto elem = capture->createElement(name, attrs);
+			if (!elem)
+				continue;
+			capture->open.back()->appendChild(elem);
+			capture->open.push_back(elem);
+		}
+
+		++m_depth;
+
+		for (auto& query : m_queries)
+		{
+			std::vector<size_t> states;
+			bool reported = false;
+			auto count = query->steps.size();
+
+			for (auto state : query->stack.back())
+			{
+				auto& step = query->steps[state];
+				if (step.descendant && std::find(states.begin(), states.end(), state) == states.end())
+					states.push_back(state);
+
+				if (!step.test(name, attrs))
+					continue;
+
+				if (step.buffered)
+				{
+					startCapture(CAPTURE_REMAINDER, *query, state, name, attrs);
+					continue;
+				}
+
+				auto next = state + 1;
+				if (next < count)
+				{
+					if (std::find(states.begin(), states.end(), next) == states.end())
+						states.push_back(next);
+					continue;
+				}
+
+				if (reported)
+					continue;
+				reported = true;
+
+				switch (query->target)
+				{
+				case TARGET_ELEMENT:
+					startCapture(CAPTURE_ELEMENT, *query, state, name, attrs);
+					break;
+				case TARGET_TEXT:
+					startCapture(CAPTURE_TEXT, *query, state, name, attrs);
+					break;
+				case TARGET_ATTRIBUTE:
+					for (auto& attr : attrs)
+					{
+						if (!like(attr.name, query->attrName))
+							continue;
+						auto node = m_scratch->createAttributeNS(attr.name.nsName.str(), qualifiedName(attr.name), attr.value.str());
+						if (node)
+							query->callback(node);
+					}
+					break;
+				}
+			}
+
+			query->stack.push_back(std::move(states));
+		}
+	}
+
+	void StreamMatcher::onEndElement(const Name&)
+	{
+		for (auto& query : m_queries)
+		{
+			if (query->stack.size() > 1)
+				query->stack.pop_back();
+		}
+
+		// captures started on this element are the last ones on the list;
+		// they are finished in the order they were started
+		std::vector<std::unique_ptr<Capture>> finished;
+		for (auto it = m_captures.begin(); it != m_captures.end();)
+		{
+			auto& capture = *it;
+			capture->flushText(m_scratch);
+			if (capture->depth != m_depth)
+			{
+				if (capture->kind != CAPTURE_TEXT)
+					capture->open.pop_back();
+				++it;
+				continue;
+			}
+
+			finished.push_back(std::move(capture));
+			it = m_captures.erase(it);
+		}
+
+		--m_depth;
+
+		for (auto& capture : finished)
+		{
+			switch (capture->kind)
+			{
+			case CAPTURE_ELEMENT:
+				capture->query->callback(capture->root);
+				break;
+			case CAPTURE_REMAINDER:
+			{
+				auto& step = capture->query->steps[capture->step];
+				auto list = XPath(step.remainder).findall(capture->root);
+				if (!list)
+					break;
+				auto length = list->length();
+				for (size_t i = 0; i < length; ++i)
+					capture->query->callback(list->item(i));
+				break;
+			}
+			default:
+				break;
+			}
+		}
+	}
+
+	void StreamMatcher::onText(env::string_ref text)
+	{
+		for (auto& capture : m_captures)
+		{
+			if (capture->kind == CAPTURE_TEXT && capture->depth != m_depth)
+				continue;
+			text.append_to(capture->text);
+		}
+	}
+}}
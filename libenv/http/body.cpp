@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2015 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <http/body.hpp>
+#include <cstdlib>
+#include <cstring>
+
+namespace net { namespace http { namespace client {
+	// implemented in posix_http.cpp / win32_http.cpp
+	void* map_anonymous(size_t size);
+	void* remap_anonymous(void* ptr, size_t old_size, size_t new_size, size_t used);
+	void unmap_anonymous(void* ptr, size_t size);
+
+	Body::Body(Body&& oth)
+		: m_data(oth.m_data)
+		, m_size(oth.m_size)
+		, m_capacity(oth.m_capacity)
+		, m_mapThreshold(oth.m_mapThreshold)
+		, m_mapped(oth.m_mapped)
+	{
+		oth.m_data = nullptr;
+		oth.m_size = 0;
+		oth.m_capacity = 0;
+		oth.m_mapped = false;
+	}
+
+	Body& Body::operator=(Body&& oth)
+	{
+		if (this == &oth)
+			return *this;
+
+		clear();
+		m_data = oth.m_data;
+		m_size = oth.m_size;
+		m_capacity = oth.m_capacity;
+		m_mapThreshold = oth.m_mapThreshold;
+		m_mapped = oth.m_mapped;
+
+		oth.m_data = nullptr;
+		oth.m_size = 0;
+		oth.m_capacity = 0;
+		oth.m_mapped = false;
+		return *this;
+	}
+
+	Body::~Body()
+	{
+		clear();
+	}
+
+	bool Body::realloc_heap(size_t capacity)
+	{
+		auto tmp = (char*)std::realloc(m_data, capacity);
+		if (!tmp)
+			return false;
+
+		m_data = tmp;
+		m_capacity = capacity;
+		return true;
+	}
+
+	bool Body::realloc_mapped(size_t capacity)
+	{
+		if (m_mapped) {
+			auto tmp = (char*)remap_anonymous(m_data, m_capacity, capacity, m_size);
+			if (!tmp)
+				return false;
+
+			m_data = tmp;
+			m_capacity = capacity;
+			return true;
+		}
+
+		auto tmp = (char*)map_anonymous(capacity);
+		if (!tmp)
+			return false;
+
+		if (m_size)
+			memcpy(tmp, m_data, m_size);
+		std::free(m_data);
+
+		m_data = tmp;
+		m_capacity = capacity;
+		m_mapped = true;
+		return true;
+	}
+
+	bool Body::reserve(size_t capacity)
+	{
+		if (m_capacity >= capacity)
+			return true;
+
+		if (m_mapped || capacity >= m_mapThreshold)
+			return realloc_mapped(capacity);
+
+		return realloc_heap(capacity);
+	}
+
+	bool Body::append(const void* data, size_t length)
+	{
+		if (!data || !length)
+			return true;
+
+		auto needed = m_size + length;
+		if (needed < m_size)
+			return false;
+
+		if (needed > m_capacity) {
+			auto capacity = m_capacity ? m_capacity : 16;
+			while (capacity < needed) {
+				auto next = capacity << 1;
+				if (next < capacity) {
+					capacity = needed;
+					break;
+				}
+				capacity = next;
+			}
+
+			if (!reserve(capacity))
+				return false;
+		}
+
+		memcpy(m_data + m_size, data, length);
+		m_size += length;
+		return true;
+	}
+
+	void Body::clear()
+	{
+		if (m_mapped)
+			unmap_anonymous(m_data, m_capacity);
+		else
+			std::free(m_data);
+
+		m_data = nullptr;
+		m_size = 0;
+		m_capacity = 0;
+		m_mapped = false;
+	}
+}}}
@@ -29,6 +29,7 @@
 #include <sstream>
 
 #include <string>
+#include <map>
 #include <cctype>
 #include <thread>
 
@@ -211,7 +212,6 @@ namespace net { namespace http {
 	{
 		int m_status;
 		std::string m_statusText;
-		std::string m_lastKey;
 		Headers m_headers;
 		bool m_headersLocked;
 		std::weak_ptr<CurlHttpEndpoint> m_owner;
@@ -249,7 +249,7 @@ namespace net { namespace http {
 		}
 
 		inline bool isRedirect() const;
-		void sendHeaders() const;
+		void sendHeaders();
 		void logHeaders() const;
 		inline bool authenticationNeeded() const;
 		std::string getRealm() const;
@@ -608,12 +608,11 @@ namespace net { namespace http {
 
 	std::string HttpCurl::getRealm() const
 	{
-		auto it = m_headers.find("www-authenticate");
-		if (it == m_headers.end())
+		if (!m_headers.has("www-authenticate"))
 			return { };
 
-		auto auth = parse_auth(it->second);
-		it = auth.params.find("realm");
+		auto auth = parse_auth(m_headers.get("www-authenticate"));
+		auto it = auth.params.find("realm");
 		if (it == auth.params.end())
 			return { };
 
@@ -667,8 +666,8 @@ namespace net { namespace http {
 			m_headersLocked = false;
 			m_status = 0;
 			m_statusText.clear();
-			m_lastKey.clear();
 			m_headers.clear();
+			m_headers.reserve(32, 2048);
 
 			C_NWS;
 			C_WS;
@@ -713,9 +712,7 @@ namespace net { namespace http {
 		if (length && isspace((unsigned char)*data))
 		{
 			C_WS;
-			std::string& lastValue = m_headers[m_lastKey];
-			lastValue += ' ';
-			Transfer::appendString(lastValue, data, length - read);
+			m_headers.extend({ data, (size_t)(length - read) });
 
 			if (rn_present)
 				length += 2; // move back the \r\n
@@ -752,20 +749,13 @@ namespace net { namespace http {
 
 			return length;
 		}
-		std::string key;
-		Transfer::appendString(key, data, pos - read);
-		key = std::tolower(key);
+		env::string_ref key { data, (size_t)(pos - read) };
 
 		read = mark + 1;
 		data = ptr + 1;
 		C_WS;
 
-		auto _it = m_headers.find(key);
-		if (_it != m_headers.end()) {
-			_it->second += ", ";
-			Transfer::appendString(_it->second, data, length - read);
-		} else
-			Transfer::appendString(m_headers[key], data, length - read);
+		m_headers.append(key, { data, (size_t)(length - read) });
 
 		if (rn_present)
 			length += 2; // move back the \r\n
@@ -776,25 +766,26 @@ namespace net { namespace http {
 	void HttpCurl::wasRedirected()
 	{
 		m_wasRedirected = true;
-		auto it = m_headers.find("location");
-		if (it != m_headers.end())
+		if (m_headers.has("location"))
 		{
 			//the spec says it should be a full URL, but there should be validation anyway here...
-			m_finalLocation = it->second;
+			m_finalLocation = m_headers.get("location");
 		}
 	}
 
-	void HttpCurl::sendHeaders() const
+	void HttpCurl::sendHeaders()
 	{
 		auto callback = getCallback();
 		if (!callback)
 			return;
 
+		// the headers are moved into the callback, log them while we still have them
+		logHeaders();
+
 		if (m_wasRedirected)
 			callback->onFinalLocation(m_finalLocation);
 
-		callback->onHeaders(m_statusText, m_status, m_headers);
-		logHeaders();
+		callback->onHeaders(m_statusText, m_status, std::move(m_headers));
 	}
 
 	void HttpCurl::logHeaders() const
@@ -1037,3 +1028,26 @@ namespace net { namespace ftp {
 			logger->onStop(ret == CURLE_OK);
 	}
 }}
+
+namespace net { namespace http {
+	struct CurlTransport : Transport
+	{
+		HttpEndpointPtr httpEndpoint(const HttpCallbackPtr& obj) override
+		{
+			return http::GetEndpoint(obj);
+		}
+
+		ftp::FtpEndpointPtr ftpEndpoint(const HttpCallbackPtr& obj) override
+		{
+			return ftp::GetEndpoint(obj);
+		}
+	};
+
+	namespace client {
+		TransportPtr curl_transport()
+		{
+			static TransportPtr transport = std::make_shared<CurlTransport>();
+			return transport;
+		}
+	}
+}}
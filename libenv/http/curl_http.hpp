@@ -26,59 +26,15 @@
 #define __CURL_HTTP_HPP__
 
 #include <http/http_logger.hpp>
+#include <http/transport.hpp>
 
 namespace net { namespace http {
-	struct HttpEndpoint;
-	struct HttpCallback;
-	using HttpEndpointPtr = std::shared_ptr<HttpEndpoint>;
-	using HttpCallbackPtr = std::shared_ptr<HttpCallback>;
-
-	typedef std::map< std::string, std::string > Headers;
-
-	struct HttpEndpoint
-	{
-		virtual ~HttpEndpoint() {}
-		virtual void send(bool async) = 0;
-		virtual void releaseEndpoint() = 0;
-		virtual void abort() = 0;
-		virtual void appendHeader(const std::string& header) = 0;
-	};
-
-	struct HttpCallback
-	{
-		virtual ~HttpCallback() {}
-		virtual void onStart() = 0;
-		virtual void onError(const std::string& error) = 0;
-		virtual void onFinish() = 0;
-		virtual size_t onData(const void* data, size_t count) = 0;
-		virtual void onFinalLocation(const std::string& location) = 0;
-		virtual void onHeaders(const std::string& reason, int http_status, const Headers& headers) = 0;
-
-		virtual void appendHeaders() = 0;
-		virtual std::string getUrl() = 0;
-		virtual std::string getUserAgent() = 0;
-		virtual void* getContent(size_t& length) = 0;
-		virtual std::shared_ptr<client::LoggingClient> getLogger() const = 0;
-		virtual long getMaxRedirs() = 0;
-		virtual bool shouldFollowLocation() = 0;
-		virtual bool headersOnly() const = 0;
-	};
+	using Headers = client::Headers;
 
 	HttpEndpointPtr GetEndpoint(const HttpCallbackPtr&);
 }}
 
 namespace net { namespace ftp {
-	struct FtpEndpoint;
-	using FtpEndpointPtr = std::shared_ptr<FtpEndpoint>;
-
-	struct FtpEndpoint
-	{
-		virtual ~FtpEndpoint() {}
-		virtual void send(bool async) = 0;
-		virtual void releaseEndpoint() = 0;
-		virtual void abort() = 0;
-	};
-
 	FtpEndpointPtr GetEndpoint(const http::HttpCallbackPtr&);
 }}
 
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2015 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <http/headers.hpp>
+#include <cctype>
+
+namespace net { namespace http { namespace client {
+
+	Headers::Headers(Headers&& oth)
+		: m_buffer(std::move(oth.m_buffer))
+		, m_entries(std::move(oth.m_entries))
+		, m_last(oth.m_last)
+	{
+		oth.clear();
+	}
+
+	Headers& Headers::operator=(Headers&& oth)
+	{
+		m_buffer = std::move(oth.m_buffer);
+		m_entries = std::move(oth.m_entries);
+		m_last = oth.m_last;
+		oth.clear();
+		return *this;
+	}
+
+	void Headers::clear()
+	{
+		m_buffer.clear();
+		m_entries.clear();
+		m_last = 0;
+	}
+
+	void Headers::reserve(size_t fields, size_t bytes)
+	{
+		m_entries.reserve(fields);
+		m_buffer.reserve(bytes);
+	}
+
+	const Headers::entry* Headers::lookup(env::string_ref name) const
+	{
+		for (auto& e : m_entries) {
+			if (e.name_length != name.length())
+				continue;
+
+			// stored names are already in lower case
+			auto stored = m_buffer.data() + e.name;
+			size_t i = 0;
+			for (; i < e.name_length; ++i) {
+				if (stored[i] != (char)std::tolower((unsigned char)name[i]))
+					break;
+			}
+			if (i == e.name_length)
+				return &e;
+		}
+		return nullptr;
+	}
+
+	env::string_ref Headers::find(env::string_ref name) const
+	{
+		auto e = lookup(name);
+		if (!e)
+			return { };
+		return ref(e->value, e->value_length);
+	}
+
+	void Headers::append(env::string_ref name, env::string_ref value)
+	{
+		auto e = const_cast<entry*>(lookup(name));
+		if (e) {
+			if (e->value + e->value_length != m_buffer.length()) {
+				// not at the end of the buffer; move the value there,
+				// abandoning the old copy
+				auto offset = m_buffer.length();
+				m_buffer.append(m_buffer, e->value, e->value_length);
+				e->value = offset;
+			}
+			m_buffer.append(", ");
+			value.append_to(m_buffer);
+			e->value_length = m_buffer.length() - e->value;
+			m_last = e - m_entries.data();
+			return;
+		}
+
+		entry fresh;
+		fresh.name = m_buffer.length();
+		fresh.name_length = name.length();
+		for (auto c : name)
+			m_buffer.push_back((char)std::tolower((unsigned char)c));
+		fresh.value = m_buffer.length();
+		fresh.value_length = value.length();
+		value.append_to(m_buffer);
+		m_last = m_entries.size();
+		m_entries.push_back(fresh);
+	}
+
+	void Headers::extend(env::string_ref value)
+	{
+		if (m_entries.empty())
+			return;
+
+		auto& e = m_entries[m_last];
+		if (e.value + e.value_length != m_buffer.length()) {
+			auto offset = m_buffer.length();
+			m_buffer.append(m_buffer, e.value, e.value_length);
+			e.value = offset;
+		}
+		m_buffer.push_back(' ');
+		value.append_to(m_buffer);
+		e.value_length = m_buffer.length() - e.value;
+	}
+}}}
@@ -0,0 +1,434 @@
+/*
+ * Copyright (C) 2015 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <http/mock.hpp>
+#include "curl_http.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace net { namespace http { namespace mock {
+	struct ServerState
+	{
+		mutable std::mutex guard;
+		Conditions conditions;
+		std::mt19937 failures { 0 };
+		std::map<std::string, Response> canned;
+		std::vector<std::pair<std::string, Generator>> generators;
+		Stats stats;
+
+		bool lookup(const std::string& url, Response& out)
+		{
+			std::vector<Generator> candidates;
+			{
+				std::lock_guard<std::mutex> lock { guard };
+				auto it = canned.find(url);
+				if (it != canned.end()) {
+					out = it->second;
+					return true;
+				}
+
+				for (auto& gen : generators) {
+					if (url.compare(0, gen.first.length(), gen.first) == 0)
+						candidates.push_back(gen.second);
+				}
+			}
+
+			// generators may take a while, let other requests through
+			for (auto& gen : candidates) {
+				if (gen(url, out))
+					return true;
+			}
+			return false;
+		}
+
+		bool shouldFail()
+		{
+			std::lock_guard<std::mutex> lock { guard };
+			if (conditions.failure_rate <= 0.0)
+				return false;
+			std::uniform_real_distribution<> dist { 0.0, 1.0 };
+			return dist(failures) < conditions.failure_rate;
+		}
+	};
+
+	class MockEndpoint
+		: public http::HttpEndpoint
+		, public ftp::FtpEndpoint
+		, public std::enable_shared_from_this<MockEndpoint>
+	{
+		std::shared_ptr<ServerState> m_server;
+		std::weak_ptr<HttpCallback> m_callback;
+		std::atomic<bool> aborting { false };
+
+		void run();
+	public:
+		MockEndpoint(const std::shared_ptr<ServerState>& server, const HttpCallbackPtr& obj)
+			: m_server(server)
+			, m_callback(obj)
+		{
+		}
+
+		void send(bool async) override
+		{
+			aborting = false;
+
+			auto cb = m_callback.lock();
+			auto thiz = shared_from_this();
+			if (async && cb)
+				std::thread([thiz]{ thiz->run(); }).detach();
+			else
+				run();
+		}
+		void releaseEndpoint() override { m_callback.reset(); }
+		void abort() override { aborting = true; }
+		void appendHeader(const std::string&) override {}
+	};
+
+	void MockEndpoint::run()
+	{
+		auto callback = m_callback.lock();
+		if (!callback)
+			return;
+
+		callback->onStart();
+
+		auto url = callback->getUrl();
+		auto logger = callback->getLogger();
+		if (logger)
+			logger->onStart(url);
+
+		Conditions conditions;
+		{
+			std::lock_guard<std::mutex> lock { m_server->guard };
+			conditions = m_server->conditions;
+			++m_server->stats.requests;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		if (conditions.latency.count())
+			std::this_thread::sleep_until(start + conditions.latency);
+
+		if (m_server->shouldFail()) {
+			{
+				std::lock_guard<std::mutex> lock { m_server->guard };
+				++m_server->stats.failures;
+			}
+			callback->onError(url + " error: injected failure");
+			if (logger)
+				logger->onStop(false);
+			return;
+		}
+
+		Response response;
+		if (!m_server->lookup(url, response)) {
+			{
+				std::lock_guard<std::mutex> lock { m_server->guard };
+				++m_server->stats.not_found;
+			}
+			response.status = 404;
+			response.reason = "Not Found";
+		}
+
+		client::Headers headers;
+		headers.reserve(response.headers.size() + 1, 256);
+		headers.append("content-length", std::to_string(response.body.length()));
+		for (auto& header : response.headers)
+			headers.append(header.first, header.second);
+
+		if (logger)
+			logger->onResponse(response.reason, response.status, headers);
+		callback->onHeaders(response.reason, response.status, std::move(headers));
+
+		if (!callback->headersOnly()) {
+			auto data = response.body.data();
+			size_t length = response.body.length();
+			size_t sent = 0;
+			auto chunk = conditions.chunk ? conditions.chunk : length;
+			auto body_start = std::chrono::steady_clock::now();
+
+			while (sent < length) {
+				if (aborting) {
+					callback->onError(url + " error: aborted");
+					if (logger)
+						logger->onStop(false);
+					return;
+				}
+
+				auto part = std::min(chunk, length - sent);
+				if (conditions.bandwidth) {
+					auto due = std::chrono::microseconds { (sent + part) * 1000000ull / conditions.bandwidth };
+					std::this_thread::sleep_until(body_start + due);
+				}
+
+				auto written = callback->onData(data + sent, part);
+				sent += written;
+				if (written != part) {
+					callback->onError(url + " error: failed writing received data");
+					if (logger)
+						logger->onStop(false);
+					return;
+				}
+			}
+
+			std::lock_guard<std::mutex> lock { m_server->guard };
+			m_server->stats.bytes += sent;
+		}
+
+		callback->onFinish();
+		if (logger)
+			logger->onStop(true);
+	}
+
+	struct MockTransport : Transport
+	{
+		std::shared_ptr<ServerState> m_server;
+
+		explicit MockTransport(const std::shared_ptr<ServerState>& server) : m_server(server) {}
+
+		HttpEndpointPtr httpEndpoint(const HttpCallbackPtr& obj) override
+		{
+			return std::make_shared<MockEndpoint>(m_server, obj);
+		}
+
+		ftp::FtpEndpointPtr ftpEndpoint(const HttpCallbackPtr& obj) override
+		{
+			return std::make_shared<MockEndpoint>(m_server, obj);
+		}
+	};
+
+	Server::Server()
+		: m_state(std::make_shared<ServerState>())
+	{
+	}
+
+	void Server::conditions(const Conditions& conditions)
+	{
+		std::lock_guard<std::mutex> lock { m_state->guard };
+		m_state->conditions = conditions;
+		m_state->failures.seed(conditions.seed);
+	}
+
+	Conditions Server::conditions() const
+	{
+		std::lock_guard<std::mutex> lock { m_state->guard };
+		return m_state->conditions;
+	}
+
+	void Server::add(const std::string& url, Response response)
+	{
+		std::lock_guard<std::mutex> lock { m_state->guard };
+		m_state->canned[url] = std::move(response);
+	}
+
+	void Server::add(const std::string& url, std::string body, const std::string& content_type)
+	{
+		Response response;
+		response.headers.emplace_back("Content-Type", content_type);
+		response.body = std::move(body);
+		add(url, std::move(response));
+	}
+
+	void Server::add_generator(const std::string& prefix, Generator generator)
+	{
+		std::lock_guard<std::mutex> lock { m_state->guard };
+		m_state->generators.emplace_back(prefix, std::move(generator));
+	}
+
+	Stats Server::stats() const
+	{
+		std::lock_guard<std::mutex> lock { m_state->guard };
+		return m_state->stats;
+	}
+
+	void Server::reset_stats()
+	{
+		std::lock_guard<std::mutex> lock { m_state->guard };
+		m_state->stats = { };
+	}
+
+	TransportPtr Server::transport() const
+	{
+		return std::make_shared<MockTransport>(m_state);
+	}
+
+	namespace {
+		struct RepoGenerator
+		{
+			RepoSpec spec;
+
+			static std::string hex(std::mt19937_64& rng, size_t digits)
+			{
+				static constexpr char alphabet[] = "0123456789abcdef";
+				std::string out(digits, '0');
+				for (auto& c : out)
+					c = alphabet[rng() & 0xF];
+				return out;
+			}
+
+			struct Package
+			{
+				std::string name;
+				std::string pkgid;
+				std::string version;
+				std::string release;
+			};
+
+			Package package(std::mt19937_64& rng, size_t index) const
+			{
+				Package pkg;
+				pkg.name = "package-" + std::to_string(index);
+				pkg.pkgid = hex(rng, 64);
+				pkg.version = std::to_string(rng() % 10) + "." + std::to_string(rng() % 20) + "." + std::to_string(rng() % 100);
+				pkg.release = std::to_string(1 + rng() % 5) + ".fc23";
+				return pkg;
+			}
+
+			static void version(std::string& out, const Package& pkg)
+			{
+				out += "<version epoch=\"0\" ver=\"" + pkg.version + "\" rel=\"" + pkg.release + "\"/>";
+			}
+
+			std::string primary() const
+			{
+				std::mt19937_64 rng { spec.seed };
+				std::string out;
+				out.reserve(spec.packages * (1024 + 64 * (spec.dependencies + 1)));
+				out += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+					"<metadata xmlns=\"http://linux.duke.edu/metadata/common\" xmlns:rpm=\"http://linux.duke.edu/metadata/rpm\" packages=\"" + std::to_string(spec.packages) + "\">\n";
+				for (size_t i = 0; i < spec.packages; ++i) {
+					auto pkg = package(rng, i);
+					out += "<package type=\"rpm\">\n  <name>" + pkg.name + "</name>\n  <arch>x86_64</arch>\n  ";
+					version(out, pkg);
+					out += "\n  <checksum type=\"sha256\" pkgid=\"YES\">" + pkg.pkgid + "</checksum>\n"
+						"  <summary>Synthetic package number " + std::to_string(i) + "</summary>\n"
+						"  <description>Generated by the mock transport &amp; used for measurements only.</description>\n"
+						"  <packager>Mock Build System</packager>\n"
+						"  <url>http://example.com/" + pkg.name + "</url>\n"
+						"  <location href=\"Packages/" + pkg.name + "-" + pkg.version + "-" + pkg.release + ".x86_64.rpm\"/>\n"
+						"  <format>\n"
+						"    <rpm:license>MIT</rpm:license>\n"
+						"    <rpm:vendor>Mock</rpm:vendor>\n"
+						"    <rpm:group>Unspecified</rpm:group>\n"
+						"    <rpm:provides>\n"
+						"      <rpm:entry name=\"" + pkg.name + "\" flags=\"EQ\" epoch=\"0\" ver=\"" + pkg.version + "\" rel=\"" + pkg.release + "\"/>\n"
+						"    </rpm:provides>\n"
+						"    <rpm:requires>\n";
+					for (size_t dep = 0; dep < spec.dependencies; ++dep) {
+						auto other = spec.packages ? rng() % spec.packages : 0;
+						out += "      <rpm:entry name=\"package-" + std::to_string(other) + "\" flags=\"GE\" epoch=\"0\" ver=\"" + std::to_string(rng() % 10) + "\"/>\n";
+					}
+					out += "    </rpm:requires>\n"
+						"    <file>/usr/bin/" + pkg.name + "</file>\n"
+						"  </format>\n"
+						"</package>\n";
+				}
+				out += "</metadata>\n";
+				return out;
+			}
+
+			std::string filelists() const
+			{
+				std::mt19937_64 rng { spec.seed };
+				std::string out;
+				out.reserve(spec.packages * (256 + 48 * spec.files));
+				out += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+					"<filelists xmlns=\"http://linux.duke.edu/metadata/filelists\" packages=\"" + std::to_string(spec.packages) + "\">\n";
+				for (size_t i = 0; i < spec.packages; ++i) {
+					auto pkg = package(rng, i);
+					for (size_t dep = 0; dep < spec.dependencies; ++dep) {
+						// keep the stream in step with primary()
+						rng();
+						rng();
+					}
+					out += "<package pkgid=\"" + pkg.pkgid + "\" name=\"" + pkg.name + "\" arch=\"x86_64\">\n  ";
+					version(out, pkg);
+					out += "\n  <file type=\"dir\">/usr/share/" + pkg.name + "</file>\n"
+						"  <file>/usr/bin/" + pkg.name + "</file>\n";
+					for (size_t file = 0; file < spec.files; ++file)
+						out += "  <file>/usr/share/" + pkg.name + "/data-" + std::to_string(file) + ".bin</file>\n";
+					out += "</package>\n";
+				}
+				out += "</filelists>\n";
+				return out;
+			}
+
+			std::string repomd() const
+			{
+				std::mt19937_64 rng { spec.seed ^ 0x5eed };
+				std::string out;
+				out += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+					"<repomd xmlns=\"http://linux.duke.edu/metadata/repo\" xmlns:rpm=\"http://linux.duke.edu/metadata/rpm\">\n"
+					"  <revision>" + std::to_string(1400000000 + spec.seed) + "</revision>\n";
+				for (auto type : { "primary", "filelists" }) {
+					out += std::string { "  <data type=\"" } + type + "\">\n"
+						"    <checksum type=\"sha256\">" + hex(rng, 64) + "</checksum>\n"
+						"    <open-checksum type=\"sha256\">" + hex(rng, 64) + "</open-checksum>\n"
+						"    <location href=\"repodata/" + type + ".xml\"/>\n"
+						"  </data>\n";
+				}
+				out += "</repomd>\n";
+				return out;
+			}
+		};
+	}
+
+	void Server::add_repo(const std::string& root, const RepoSpec& spec)
+	{
+		struct Bodies
+		{
+			std::string repomd;
+			std::string primary;
+			std::string filelists;
+		};
+
+		// the repository never changes, so its files are generated once
+		RepoGenerator repo { spec };
+		auto bodies = std::make_shared<Bodies>();
+		bodies->repomd = repo.repomd();
+		bodies->primary = repo.primary();
+		bodies->filelists = repo.filelists();
+
+		add_generator(root, [root, bodies](const std::string& url, Response& out) {
+			auto path = url.substr(root.length());
+			if (path == "repodata/repomd.xml")
+				out.body = bodies->repomd;
+			else if (path == "repodata/primary.xml")
+				out.body = bodies->primary;
+			else if (path == "repodata/filelists.xml")
+				out.body = bodies->filelists;
+			else
+				return false;
+
+			out.headers.emplace_back("Content-Type", "application/xml");
+			return true;
+		});
+	}
+}}}
@@ -25,6 +25,7 @@
 #include <cstring>
 #include <string>
 #include <sys/utsname.h>
+#include <sys/mman.h>
 
 namespace net { namespace http { namespace client {
 	std::string os_client_info()
@@ -46,4 +47,32 @@ namespace net { namespace http { namespace client {
 			version.append(unixinfo.machine);
 		return version;
 	}
+
+	void* map_anonymous(size_t size)
+	{
+		auto ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		return ptr == MAP_FAILED ? nullptr : ptr;
+	}
+
+	void* remap_anonymous(void* ptr, size_t old_size, size_t new_size, size_t used)
+	{
+#ifdef MREMAP_MAYMOVE
+		(void)used; // the kernel moves the whole mapping
+		auto moved = mremap(ptr, old_size, new_size, MREMAP_MAYMOVE);
+		return moved == MAP_FAILED ? nullptr : moved;
+#else
+		auto moved = map_anonymous(new_size);
+		if (!moved)
+			return nullptr;
+		memcpy(moved, ptr, used);
+		munmap(ptr, old_size);
+		return moved;
+#endif
+	}
+
+	void unmap_anonymous(void* ptr, size_t size)
+	{
+		if (ptr)
+			munmap(ptr, size);
+	}
 }}}
@@ -24,6 +24,7 @@
 
 #include <sdkddkver.h>
 #include <windows.h>
+#include <cstring>
 #include <tchar.h>
 #include <string>
 
@@ -129,4 +130,25 @@ namespace net { namespace http { namespace client {
 #endif
 		return version;
 	}
+
+	void* map_anonymous(size_t size)
+	{
+		return VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	}
+
+	void* remap_anonymous(void* ptr, size_t old_size, size_t new_size, size_t used)
+	{
+		auto moved = map_anonymous(new_size);
+		if (!moved)
+			return nullptr;
+		memcpy(moved, ptr, used);
+		VirtualFree(ptr, 0, MEM_RELEASE);
+		return moved;
+	}
+
+	void unmap_anonymous(void* ptr, size_t)
+	{
+		if (ptr)
+			VirtualFree(ptr, 0, MEM_RELEASE);
+	}
 }}}
@@ -29,6 +29,8 @@
 #include <cstring>
 #include <cctype>
 #include <string>
+#include <map>
+#include <mutex>
 
 namespace std
 {
@@ -42,69 +44,6 @@ namespace std
 namespace net { namespace http {
 	namespace impl
 	{
-		struct ContentData
-		{
-			char* content;
-			size_t content_length;
-			size_t capacity;
-			ContentData()
-				: content(nullptr)
-				, content_length(0)
-				, capacity(0)
-			{
-			}
-			~ContentData()
-			{
-				delete [] content;
-			}
-
-			bool grow(size_t newsize)
-			{
-				if (capacity >= newsize)
-					return true;
-
-				auto copy_capacity = capacity;
-				if (!copy_capacity)
-					copy_capacity = 16;
-
-				while (copy_capacity < newsize)
-					copy_capacity <<= 1;
-
-				auto tmp = new (std::nothrow) char[copy_capacity];
-				if (!tmp)
-					return false;
-
-				if (content)
-					memcpy(tmp, content, content_length);
-
-				delete [] content;
-				content = tmp;
-				capacity = copy_capacity;
-				return true;
-			}
-
-			bool append(const void* data, size_t len)
-			{
-				if (data && len)
-				{
-					if (!grow(content_length + len))
-						return false;
-
-					memcpy(content + content_length, data, len);
-					content_length += len;
-				}
-				return true;
-			}
-
-			void clear()
-			{
-				delete [] content;
-				content = nullptr;
-				content_length = 0;
-				capacity = 0;
-			}
-		};
-
 		class XmlHttpRequest
 			: public client::XmlHttpRequest
 			, public http::HttpCallback
@@ -117,16 +56,17 @@ namespace net { namespace http {
 			std::string url;
 			std::string userAgent;
 			bool async;
-			Headers request_headers;
+			std::map<std::string, std::string> request_headers;
 			READY_STATE ready_state;
-			ContentData body;
+			client::Body body;
 
 			int http_status;
 			std::string reason;
 			Headers response_headers;
-			ContentData response;
+			client::Body response;
 
 			bool send_flag, done_flag;
+			TransportPtr m_transport;
 			HttpEndpointPtr m_http_endpoint;
 			ftp::FtpEndpointPtr m_ftp_endpoint;
 			std::shared_ptr<client::LoggingClient> logger;
@@ -167,7 +107,7 @@ namespace net { namespace http {
 			}
 		public:
 
-			XmlHttpRequest(const std::string& userAgent)
+			XmlHttpRequest(const std::string& userAgent, const TransportPtr& transport)
 				: http_method(client::HTTP_GET)
 				, userAgent(userAgent)
 				, async(true)
@@ -175,6 +115,7 @@ namespace net { namespace http {
 				, http_status(0)
 				, send_flag(false)
 				, done_flag(false)
+				, m_transport(transport)
 				, m_followRedirects(true)
 				, m_redirects(10)
 				, m_wasRedirected(false)
@@ -203,9 +144,11 @@ namespace net { namespace http {
 			int getStatus() const override;
 			std::string getStatusText() const override;
 			std::string getResponseHeader(const std::string&) const override;
-			std::map<std::string, std::string> getResponseHeaders() const override;
+			const client::Headers& getResponseHeaders() const override;
 			size_t getResponseTextLength() const override;
 			const char* getResponseText() const override;
+			client::Body takeResponseBody() override;
+			void setBodyMapThreshold(size_t) override;
 
 			bool wasRedirected() const override;
 			const std::string getFinalLocation() const override;
@@ -220,7 +163,7 @@ namespace net { namespace http {
 			void onFinish() override;
 			size_t onData(const void*, size_t) override;
 			void onFinalLocation(const std::string&) override;
-			void onHeaders(const std::string&, int, const Headers&) override;
+			void onHeaders(const std::string&, int, Headers&&) override;
 
 			void appendHeaders() override;
 			std::string getUrl() override;
@@ -279,7 +222,7 @@ namespace net { namespace http {
 			if (ready_state != OPENED || send_flag) return;
 
 			auto _h = std::tolower(header);
-			Headers::iterator _it = request_headers.find(_h);
+			auto _it = request_headers.find(_h);
 			if (_it == request_headers.end())
 			{
 				if (_h == "accept-charset") return;
@@ -335,12 +278,12 @@ namespace net { namespace http {
 			done_flag = false;
 			if (std::tolower(url.substr(0, 6)) == "ftp://") {
 				if (!m_ftp_endpoint)
-					m_ftp_endpoint = ftp::GetEndpoint(shared_from_this());
+					m_ftp_endpoint = m_transport->ftpEndpoint(shared_from_this());
 				if (m_ftp_endpoint)
 					m_ftp_endpoint->send(async);
 			} else {
 				if (!m_http_endpoint)
-					m_http_endpoint = http::GetEndpoint(shared_from_this());
+					m_http_endpoint = m_transport->httpEndpoint(shared_from_this());
 				if (m_http_endpoint)
 					m_http_endpoint->send(async);
 			}
@@ -366,24 +309,35 @@ namespace net { namespace http {
 
 		std::string XmlHttpRequest::getResponseHeader(const std::string& name) const
 		{
-			Headers::const_iterator _it = response_headers.find(std::tolower(name));
-			if (_it == response_headers.end()) return std::string();
-			return _it->second;
+			return response_headers.get(name);
 		}
 
-		std::map<std::string, std::string> XmlHttpRequest::getResponseHeaders() const
+		const client::Headers& XmlHttpRequest::getResponseHeaders() const
 		{
 			return response_headers;
 		}
 
 		size_t XmlHttpRequest::getResponseTextLength() const
 		{
-			return response.content_length;
+			return response.size();
 		}
 
 		const char* XmlHttpRequest::getResponseText() const
 		{
-			return (const char*)response.content;
+			return response.data();
+		}
+
+		client::Body XmlHttpRequest::takeResponseBody()
+		{
+			auto threshold = response.mapThreshold();
+			client::Body out { std::move(response) };
+			response.setMapThreshold(threshold);
+			return out;
+		}
+
+		void XmlHttpRequest::setBodyMapThreshold(size_t threshold)
+		{
+			response.setMapThreshold(threshold);
 		}
 
 		bool XmlHttpRequest::wasRedirected() const { return m_wasRedirected; }
@@ -411,8 +365,7 @@ namespace net { namespace http {
 
 		void XmlHttpRequest::onStart()
 		{
-			if (http_method == client::HTTP_POST &&
-				(!body.content || !body.content_length))
+			if (http_method == client::HTTP_POST && body.empty())
 				http_method = client::HTTP_GET;
 
 			//onReadyStateChange();
@@ -454,22 +407,29 @@ namespace net { namespace http {
 			m_finalLocation = location;
 		}
 
-		void XmlHttpRequest::onHeaders(const std::string& reason_, int http_status_, const Headers& headers)
+		void XmlHttpRequest::onHeaders(const std::string& reason_, int http_status_, Headers&& headers)
 		{
 			//Synchronize on(*this);
 			http_status = http_status_;
 			reason = reason_;
 
-			for (auto&& item : headers)
-				response_headers[std::tolower(item.first)] = item.second;
+			response_headers = std::move(headers);
 
 			m_contentLength = 0;
-			auto length = getResponseHeader("content-length");
-			if (!length.empty())
-				m_contentLength = std::stoull(length);
+			for (auto c : response_headers.find("content-length")) {
+				if (!isdigit((unsigned char)c))
+					break;
+				m_contentLength *= 10;
+				m_contentLength += c - '0';
+			}
 
 			m_lengthCalculable = m_contentLength > 0;
 
+			// one allocation for the whole body, instead of doubling
+			// the buffer all the way up from 16 bytes
+			if (m_lengthCalculable && http_method != client::HTTP_HEAD && m_contentLength <= (size_t)-1)
+				response.reserve((size_t)m_contentLength);
+
 			ready_state = HEADERS_RECEIVED;
 			onProgress(0);
 			onReadyStateChange();
@@ -486,7 +446,7 @@ namespace net { namespace http {
 
 		std::string XmlHttpRequest::getUrl() { return url; }
 		std::string XmlHttpRequest::getUserAgent() { return userAgent; }
-		void* XmlHttpRequest::getContent(size_t& length) { if (http_method == client::HTTP_POST) { length = body.content_length; return body.content; } return nullptr; }
+		void* XmlHttpRequest::getContent(size_t& length) { if (http_method == client::HTTP_POST) { length = body.size(); return body.data(); } return nullptr; }
 		std::shared_ptr<client::LoggingClient> XmlHttpRequest::getLogger() const { return logger; }
 		bool XmlHttpRequest::shouldFollowLocation() { return m_followRedirects; }
 		long XmlHttpRequest::getMaxRedirs() { return m_redirects; }
@@ -516,10 +476,35 @@ namespace net { namespace http {
 			return userAgent;
 		}
 
+		static std::mutex s_transport_guard;
+		static TransportPtr s_transport;
+
+		void set_default_transport(const TransportPtr& transport)
+		{
+			std::lock_guard<std::mutex> lock { s_transport_guard };
+			s_transport = transport;
+		}
+
+		TransportPtr default_transport()
+		{
+			std::lock_guard<std::mutex> lock { s_transport_guard };
+			if (!s_transport)
+				return curl_transport();
+			return s_transport;
+		}
+
 		XmlHttpRequestPtr create()
 		{
+			return create(default_transport());
+		}
+
+		XmlHttpRequestPtr create(const TransportPtr& transport)
+		{
+			if (!transport)
+				return nullptr;
+
 			try {
-				return std::make_shared<impl::XmlHttpRequest>(getUserAgent());
+				return std::make_shared<impl::XmlHttpRequest>(getUserAgent(), transport);
 			} catch (std::bad_alloc) {
 				return nullptr;
 			}
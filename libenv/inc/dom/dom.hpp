@@ -34,6 +34,7 @@
 #include <dom/nodes/attribute.hpp>
 #include <dom/nodes/text.hpp>
 #include <dom/range.hpp>
+#include <dom/walk.hpp>
 
 namespace dom
 {
@@ -26,9 +26,16 @@
 #define __DOM_XPATH_HPP__
 
 #include <list>
+#include <vector>
 
 namespace dom
 {
+	namespace impl
+	{
+		class NameTable;
+		class Element;
+	}
+
 	namespace xpath
 	{
 		enum AXIS
@@ -61,26 +68,46 @@ namespace dom
 			PRED_EQUALS
 		};
 
+		// Receives the nodes selected by a step; returning false stops
+		// the evaluation.
+		struct Sink
+		{
+			virtual ~Sink() {}
+			virtual bool push(Node* node) = 0;
+			// An attribute, still kept in the element's slot; sinks, which
+			// need no Attribute node for it, keep it that way. The default
+			// creates the node and pushes it.
+			virtual bool pushAttribute(impl::Element* elem, size_t index);
+		};
+
+		class NameMatch;
+		class Evaluation;
+
+		// All select functions return false, if the sink stopped them.
+		// A selector keeps nothing between calls; its name is resolved
+		// by the Evaluation, which only lives for one find or findall.
 		struct SimpleSelector
 		{
 			AXIS m_axis;
 			TEST m_test;
 			QName m_name;
 			SimpleSelector(): m_axis(AXIS_CHILD), m_test(TEST_NODE) {}
-			bool passable(NodePtr& node);
-			void select(const NodePtr& context, std::list<NodePtr>& list);
+			bool select(Node* context, Sink& out, Evaluation& eval) const;
+			// For attribute tests: does any matching attribute of the
+			// element have the value; no attribute nodes are created.
+			bool attributeEquals(Node* context, const std::string& value, Evaluation& eval) const;
 		private:
-			void test(const NodePtr& node, std::list<NodePtr>& list);
-			void select(const NodeListPtr& nodes, std::list<NodePtr>& list);
-
-			void child(const NodePtr& context, std::list<NodePtr>& list);
-			void descendant(const NodePtr& context, std::list<NodePtr>& list);
-			void attribute(const NodePtr& context, std::list<NodePtr>& list);
-			void self(const NodePtr& context, std::list<NodePtr>& list);
-			void descendant_or_self(const NodePtr& context, std::list<NodePtr>& list);
-			void parent(const NodePtr& context, std::list<NodePtr>& list);
-			void ancestor(const NodePtr& context, std::list<NodePtr>& list);
-			void ancestor_or_self(const NodePtr& context, std::list<NodePtr>& list);
+			bool passable(Node*& node, NameMatch& match) const;
+			bool test(Node* node, Sink& out, NameMatch& match) const;
+
+			bool child(Node* context, Sink& out, NameMatch& match) const;
+			bool descendant(Node* context, Sink& out, NameMatch& match) const;
+			bool attribute(Node* context, Sink& out, NameMatch& match) const;
+			bool self(Node* context, Sink& out, NameMatch& match) const;
+			bool descendant_or_self(Node* context, Sink& out, NameMatch& match) const;
+			bool parent(Node* context, Sink& out, NameMatch& match) const;
+			bool ancestor(Node* context, Sink& out, NameMatch& match) const;
+			bool ancestor_or_self(Node* context, Sink& out, NameMatch& match) const;
 		};
 		typedef std::list<SimpleSelector> SimpleSelectors;
 
@@ -90,7 +117,7 @@ namespace dom
 			SimpleSelectors m_selectors;
 			std::string m_value;
 			Predicate(): m_type(PRED_EXISTS) {}
-			bool test(const NodePtr& context);
+			bool test(Node* context, Evaluation& eval) const;
 		};
 		typedef std::list<Predicate> Predicates;
 
@@ -98,20 +125,37 @@ namespace dom
 		{
 			SimpleSelector m_selector;
 			Predicates m_preds;
-			void select(const NodePtr& context, std::list<NodePtr>& list);
+			bool select(Node* context, Sink& out, Evaluation& eval) const;
 		};
 		typedef std::list<Segment> Segments;
 
 		struct XPath
 		{
 			XPath(const std::string& xpath, const Namespaces& ns);
-			NodePtr find(const NodePtr& context);
-			NodeListPtr findall(const NodePtr& context);
+			explicit XPath(Segments segments) : m_segments(std::move(segments)) {}
+			// Both stop walking the tree, as soon as they have enough nodes.
+			NodePtr find(const NodePtr& context) const;
+			NodeListPtr findall(const NodePtr& context, size_t limit = (size_t)-1) const;
 			Segments m_segments;
 		private:
 			const char* readSegment(const char* ptr, const char* end, Segment& seg, const Namespaces& ns);
 		};
 		std::ostream& operator << (std::ostream& o, const XPath& qname);
+
+		// Compiled paths are immutable: evaluation keeps its state on its
+		// own stack, so one XPath can be shared between documents and
+		// threads. Several evaluations can run on one document at a time
+		// as long as nothing changes it meanwhile.
+		typedef std::shared_ptr<const XPath> XPathPtr;
+
+		// Parses the expression once; the result can be evaluated against
+		// any number of nodes of any number of documents.
+		XPathPtr compile(const std::string& xpath, const Namespaces& ns);
+
+		// Same as compile, through a small per-thread LRU cache keyed by
+		// the expression and the contents of the namespace table. The
+		// returned XPath may be shared with any other caller.
+		XPathPtr cached(const std::string& xpath, const Namespaces& ns);
 	};
 }
 
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2013 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DOM_FROZEN_HPP__
+#define __DOM_FROZEN_HPP__
+
+#include <dom/dom.hpp>
+#include <dom/dom_xpath.hpp>
+#include <env/string_ref.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace dom
+{
+	class FrozenDocument;
+	using FrozenDocumentPtr = std::shared_ptr<const FrozenDocument>;
+
+	// Read-only copy of a document, for querying after the parse is
+	// done. Nodes are entries in one array, in document order, and are
+	// addressed by their index: the document itself is entry 0, each
+	// element is followed by its attributes, then by its descendants,
+	// so a subtree is a contiguous range. Names are interned per copy
+	// and all text lives in a single buffer.
+	//
+	// Nothing changes after freeze(), so a copy can be queried from any
+	// number of threads at once.
+	class FrozenDocument
+	{
+	public:
+		using Index = uint32_t;
+		static constexpr Index npos = (Index)-1;
+
+		static FrozenDocumentPtr freeze(const DocumentPtr& doc);
+
+		size_t size() const { return m_entries.size(); }
+		Index documentElement() const;
+
+		NODE_TYPE nodeType(Index node) const { return m_entries[node].type; }
+		const std::string& nodeName(Index node) const { return m_names[m_entries[node].name]; }
+		const QName& nodeQName(Index node) const { return m_qnames[m_entries[node].qname]; }
+		// Text and attribute values; empty for elements and the document.
+		env::string_ref nodeValue(Index node) const
+		{
+			auto& entry = m_entries[node];
+			return { m_text.data() + entry.offset, entry.length };
+		}
+		// The nodeValue or, for elements and the document, the text of
+		// all the descendants, same as Node::stringValue.
+		std::string stringValue(Index node) const;
+
+		Index parentNode(Index node) const { return m_entries[node].parent; }
+		Index firstChild(Index node) const;
+		Index nextSibling(Index node) const;
+		Index attributeCount(Index node) const { return m_entries[node].attrs; }
+		// Attributes of an element are the entries right after it.
+		Index attribute(Index node, Index pos) const { return node + 1 + pos; }
+		Index getAttributeNode(Index node, const std::string& name) const;
+
+		// One past the last entry of the subtree.
+		Index subtreeEnd(Index node) const { return m_entries[node].end; }
+
+		Index find(const xpath::XPathPtr& xpath, Index context = 0) const;
+		std::vector<Index> findall(const xpath::XPathPtr& xpath, Index context = 0, size_t limit = (size_t)-1) const;
+		Index find(const std::string& path, const Namespaces& ns, Index context = 0) const
+		{
+			return find(xpath::cached(path, ns), context);
+		}
+		std::vector<Index> findall(const std::string& path, const Namespaces& ns, Index context = 0, size_t limit = (size_t)-1) const
+		{
+			return findall(xpath::cached(path, ns), context, limit);
+		}
+
+		// npos, if there is no such name in the document.
+		uint32_t findQName(const QName& qname) const;
+
+		struct Entry
+		{
+			NODE_TYPE type;
+			Index parent;
+			Index end;      // one past the last attribute or descendant
+			Index attrs;    // number of attributes
+			uint32_t name;  // index into m_names
+			uint32_t qname; // index into m_qnames
+			size_t offset;  // value in m_text
+			size_t length;
+		};
+
+	private:
+		struct QNameHash
+		{
+			size_t operator()(const QName& qname) const
+			{
+				std::hash<std::string> hash;
+				return hash(qname.nsName) * 31 + hash(qname.localName);
+			}
+		};
+
+		std::vector<Entry> m_entries;
+		std::vector<std::string> m_names;
+		std::vector<QName> m_qnames;
+		std::unordered_map<QName, uint32_t, QNameHash> m_qnameLookup;
+		std::string m_text;
+
+		friend class FreezeBuilder;
+		friend class FrozenEvaluator;
+	};
+}
+
+#endif // __DOM_FROZEN_HPP__
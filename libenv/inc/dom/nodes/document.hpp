@@ -26,18 +26,18 @@
 #define __DOM_DOCUMENT_HPP__
 
 #include <dom/nodes/node.hpp>
-#if 0
-#include <filesystem.hpp>
-#endif
 
 namespace dom
 {
 	struct Document : Node
 	{
 		static DocumentPtr create();
-#if 0
-		static DocumentPtr fromFile(const filesystem::path& path);
-#endif
+		// Nodes created by this document are carved out of a single
+		// arena, which is freed in one go, after the document and the
+		// last node referencing it are released. A blockSize of 0 picks
+		// the default.
+		static DocumentPtr createWithArena(size_t blockSize = 0);
+		static DocumentPtr fromFile(const std::string& path);
 
 		virtual ElementPtr documentElement() = 0;
 		virtual void setDocumentElement(const ElementPtr& elem) = 0;
@@ -47,10 +47,20 @@ namespace dom
 		virtual ElementPtr createElement(const std::string& tagName) = 0;
 		virtual TextPtr createTextNode(const std::string& data) = 0;
 		virtual AttributePtr createAttribute(const std::string& name, const std::string& value) = 0;
+		// The namespace is bound at creation and is not looked up again
+		// from xmlns attributes of the node's ancestors.
+		virtual ElementPtr createElementNS(const std::string& nsName, const std::string& qualifiedName) = 0;
+		virtual AttributePtr createAttributeNS(const std::string& nsName, const std::string& qualifiedName, const std::string& value) = 0;
 		virtual DocumentFragmentPtr createDocumentFragment() = 0;
 
+		// Lookups on the whole document go through indexes, built on
+		// first use and dropped, when the document changes. The indexes
+		// and the Attribute nodes created on read are guarded, so reads
+		// can run on several threads at a time; any change to the
+		// document, including through an Attribute, needs it to itself.
 		virtual NodeListPtr getElementsByTagName(const std::string& tagName) = 0;
 		virtual ElementPtr getElementById(const std::string& elementId) = 0;
+		virtual NodeListPtr getElementsByAttribute(const std::string& name, const std::string& value) = 0;
 	};
 }
 
@@ -38,6 +38,7 @@ namespace dom
 		virtual bool setAttribute(const AttributePtr& attr) = 0;
 		virtual bool removeAttribute(const AttributePtr& attr) = 0;
 		virtual bool setAttribute(const std::string& attr, const std::string& value) = 0;
+		virtual bool setAttributeNS(const std::string& nsName, const std::string& qualifiedName, const std::string& value) = 0;
 		virtual bool removeAttribute(const std::string& attr) = 0;
 		virtual NodeListPtr getAttributes() = 0;
 		virtual bool hasAttribute(const std::string& name) = 0;
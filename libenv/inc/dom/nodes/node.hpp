@@ -100,6 +100,7 @@ namespace dom
 		virtual NodePtr find(const std::string& path, const Namespaces& ns) = 0;
 		virtual NodePtr find(const std::string& path) { return find(path, nullptr); }
 		virtual NodeListPtr findall(const std::string& path, const Namespaces& ns) = 0;
+		virtual NodeListPtr findall(const std::string& path, const Namespaces& ns, size_t limit) = 0;
 	};
 
 	struct ChildNode : Node
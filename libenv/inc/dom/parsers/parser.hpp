@@ -25,10 +25,9 @@
 #ifndef __DOM_PARSERS_PARSER_HPP__
 #define __DOM_PARSERS_PARSER_HPP__
 
-#if 0
-#include <filesystem.hpp>
-#endif
 #include <dom/nodes/document.hpp>
+#include <cstdint>
+#include <cstdio>
 
 namespace dom { namespace parsers {
 
@@ -38,12 +37,29 @@ namespace dom { namespace parsers {
 		virtual bool supportsChunks() const = 0;
 		virtual bool onData(const void* data, size_t length) = 0;
 		virtual DocumentPtr onFinish() = 0;
+
+		// Lets the caller read straight into the parser's own buffer:
+		// getBuffer(length) hands out room for up to length bytes,
+		// onBuffer(length) parses the first length bytes written there.
+		// Parsers without a buffer of their own get fed through onData.
+		virtual bool supportsBuffers() const { return false; }
+		virtual void* getBuffer(size_t) { return nullptr; }
+		virtual bool onBuffer(size_t) { return false; }
 	};
 	using ParserPtr = std::shared_ptr<Parser>;
 
-#if 0
-	DocumentPtr parseFile(const ParserPtr& parser, const filesystem::path& path);
-#endif
+	struct ParseStats
+	{
+		uint64_t bytes = 0;
+		double seconds = 0;
+
+		double bytesPerSecond() const { return seconds > 0 ? bytes / seconds : 0; }
+	};
+
+	// Reads the file in fixed-size chunks, so neither memory use nor the
+	// maximum size depends on the size of the input.
+	DocumentPtr parseFile(const ParserPtr& parser, FILE* file, ParseStats* stats = nullptr);
+	DocumentPtr parseFile(const ParserPtr& parser, const std::string& path, ParseStats* stats = nullptr);
 
 	static inline DocumentPtr parseDocument(const ParserPtr& parser, const void* data, size_t size)
 	{
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2015 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef __DOM_PARSERS_SAX_HPP__
+#define __DOM_PARSERS_SAX_HPP__
+
+#include <memory>
+#include <string>
+#include <env/string_ref.hpp>
+
+namespace dom { namespace parsers { namespace sax {
+
+	// All the views handed to a Handler point into the parser's own
+	// buffers and are only valid until the callback returns.
+
+	struct Name
+	{
+		env::string_ref nsName;
+		env::string_ref localName;
+		env::string_ref prefix;
+
+		std::string qualified() const
+		{
+			if (prefix.empty())
+				return localName.str();
+			return prefix.str() + ":" + localName.str();
+		}
+	};
+
+	struct Attribute
+	{
+		Name name;
+		env::string_ref value;
+	};
+
+	class Attributes
+	{
+		const Attribute* m_data;
+		size_t m_size;
+	public:
+		Attributes(const Attribute* data, size_t size) : m_data(data), m_size(size) {}
+
+		size_t size() const { return m_size; }
+		bool empty() const { return !m_size; }
+		const Attribute& operator[](size_t index) const { return m_data[index]; }
+		const Attribute* begin() const { return m_data; }
+		const Attribute* end() const { return m_data + m_size; }
+
+		// Attribute with no namespace and given local name, or nullptr.
+		const Attribute* find(env::string_ref localName) const
+		{
+			return find({ }, localName);
+		}
+
+		const Attribute* find(env::string_ref nsName, env::string_ref localName) const
+		{
+			for (auto& attr : *this) {
+				if (attr.name.localName == localName && attr.name.nsName == nsName)
+					return &attr;
+			}
+			return nullptr;
+		}
+	};
+
+	struct Handler
+	{
+		virtual ~Handler() {}
+
+		// Namespace declarations are reported before the start tag they
+		// were made on; the xmlns attributes do not show up in Attributes.
+		virtual void onStartNamespace(env::string_ref /*prefix*/, env::string_ref /*uri*/) {}
+		virtual void onEndNamespace(env::string_ref /*prefix*/) {}
+		virtual void onStartElement(const Name& /*name*/, const Attributes& /*attrs*/) {}
+		virtual void onEndElement(const Name& /*name*/) {}
+		// A single run of text may be reported in several pieces.
+		virtual void onText(env::string_ref /*text*/) {}
+	};
+
+	struct Parser
+	{
+		virtual ~Parser() {}
+		virtual bool onData(const void* data, size_t length) = 0;
+		virtual bool onFinish() = 0;
+
+		// Can be called from inside of a callback; the current onData
+		// returns false afterwards, with stopped() telling it apart
+		// from a syntax error.
+		virtual void stop() = 0;
+		virtual bool stopped() const = 0;
+
+		virtual std::string errorMessage() const = 0;
+		virtual size_t line() const = 0;
+		virtual size_t column() const = 0;
+	};
+	using ParserPtr = std::shared_ptr<Parser>;
+
+	ParserPtr create(Handler& handler, const std::string& encoding = std::string());
+
+	static inline bool parse(Handler& handler, const void* data, size_t size, const std::string& encoding = std::string())
+	{
+		auto parser = create(handler, encoding);
+		if (!parser)
+			return false;
+
+		if (!parser->onData(data, size))
+			return false;
+
+		return parser->onFinish();
+	}
+}}}
+
+#endif // __DOM_PARSERS_SAX_HPP__
@@ -44,6 +44,13 @@ namespace dom { namespace parsers { namespace xml {
 		return parser->onFinish();
 	}
 
+	// For documents made of a root holding a long, flat run of records,
+	// like primary.xml or filelists.xml: the input is cut in front of the
+	// recordTag start tags and the parts are parsed on separate threads,
+	// then joined in order under a single root. Inputs which do not split
+	// cleanly are parsed in one piece. A threads of 0 uses every core.
+	DocumentPtr parseRecords(const std::string& encoding, const void* data, size_t size, const std::string& recordTag, size_t threads = 0);
+
 }}}
 
 #endif // __DOM_PARSERS_XML_HPP__
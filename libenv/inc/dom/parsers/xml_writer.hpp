@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2013 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DOM_PARSERS_XML_WRITER_HPP__
+#define __DOM_PARSERS_XML_WRITER_HPP__
+
+#include <dom/nodes/node.hpp>
+#include <dom/parsers/parser.hpp>
+#include <dom/parsers/sax.hpp>
+#include <cstdio>
+#include <vector>
+
+namespace dom { namespace parsers { namespace xml {
+
+	class FileOutStream : public OutStream
+	{
+		FILE* m_file;
+	public:
+		explicit FileOutStream(FILE* file) : m_file(file) {}
+		void putc(char c) override { fputc(c, m_file); }
+		void puts(const char* s, size_t length) override { fwrite(s, 1, length, m_file); }
+	};
+
+	// Serializes XML into an OutStream through a buffer of fixed size, so
+	// memory use depends on the nesting depth only, not on the size of
+	// the output. Elements can be written one event at a time, as whole
+	// subtrees of a DOM or straight from a SAX parser, in any mix.
+	//
+	// Names are written as given; text and attribute values are escaped.
+	// An element with no content is closed as <name/>.
+	class Writer : public sax::Handler
+	{
+	public:
+		static constexpr size_t default_buffer = 64 * 1024;
+
+		explicit Writer(OutStream& out, size_t bufferSize = default_buffer);
+		~Writer();
+		Writer(const Writer&) = delete;
+		Writer& operator=(const Writer&) = delete;
+
+		void declaration();
+		void startElement(env::string_ref qualifiedName);
+		// Only valid right after startElement or another attribute.
+		void attribute(env::string_ref qualifiedName, env::string_ref value);
+		void endElement();
+		void text(env::string_ref text);
+
+		// Node and everything below it; a document is written as its
+		// children.
+		void write(Node& node);
+		void write(const NodePtr& node) { if (node) write(*node); }
+
+		// Pushes the buffer to the stream; also done by the destructor.
+		void flush();
+
+		void onStartNamespace(env::string_ref prefix, env::string_ref uri) override;
+		void onStartElement(const sax::Name& name, const sax::Attributes& attrs) override;
+		void onEndElement(const sax::Name& name) override;
+		void onText(env::string_ref text) override;
+
+	private:
+		OutStream& m_out;
+		std::vector<char> m_buffer;
+		size_t m_used = 0;
+		bool m_startOpen = false;
+		// kept for the whole life of the writer, so the strings reuse
+		// their memory from one element to the next
+		std::vector<std::string> m_stack;
+		size_t m_depth = 0;
+		std::vector<std::pair<std::string, std::string>> m_nsDecls;
+
+		void append(const char* data, size_t length);
+		void append(env::string_ref data) { append(data.data(), data.size()); }
+		void escape(env::string_ref data, bool attr);
+		void closeStart();
+		std::string& push();
+		void attribute(env::string_ref prefix, env::string_ref localName, env::string_ref value);
+	};
+}}}
+
+#endif // __DOM_PARSERS_XML_WRITER_HPP__
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2013 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DOM_WALK_HPP__
+#define __DOM_WALK_HPP__
+
+#include <dom/nodes/node.hpp>
+
+namespace dom
+{
+	// Receives the nodes of a walk in document order. The references are
+	// borrowed from the tree for the duration of the call; keep a NodePtr
+	// (through find or parentNode) only for the nodes, which need to
+	// outlive the walk. Attributes are not part of the walk.
+	struct Visitor
+	{
+		enum ACTION
+		{
+			CONTINUE, // go into the children of the node
+			SKIP,     // leave the children out
+			STOP      // end the walk
+		};
+
+		virtual ~Visitor() {}
+		virtual ACTION onEnter(Node& node) = 0;
+		// Called for every node, which onEnter did not stop on; returning
+		// false ends the walk.
+		virtual bool onLeave(Node&) { return true; }
+	};
+
+	// Visits node and everything below it, without touching any reference
+	// counts. Returns false, if the visitor stopped the walk. The tree
+	// must not be changed during the walk.
+	bool walk(Node& node, Visitor& visitor);
+	inline bool walk(const NodePtr& node, Visitor& visitor)
+	{
+		return !node || walk(*node, visitor);
+	}
+}
+
+#endif // __DOM_WALK_HPP__
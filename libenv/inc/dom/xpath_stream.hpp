@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2013 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DOM_XPATH_STREAM_HPP__
+#define __DOM_XPATH_STREAM_HPP__
+
+#include <dom/dom.hpp>
+#include <dom/dom_xpath.hpp>
+#include <dom/parsers/sax.hpp>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace dom
+{
+	namespace xpath
+	{
+		// Evaluates location paths against a SAX parse, without building
+		// the document. A path can be streamed, if it is made of child
+		// element steps, optionally with '//' before them, and ends with
+		// an element, an @attribute or text(). Attribute predicates are
+		// checked on the start tag; a step with any other predicate has
+		// its subtree buffered into a small DOM and the rest of the path
+		// is evaluated on that, once the element is closed.
+		//
+		// Element matches are reported when the element ends, attribute
+		// matches at the start tag and text runs as they end. The nodes
+		// passed to the callbacks are detached subtrees, created by
+		// a scratch document the matcher owns.
+		class StreamMatcher : public parsers::sax::Handler
+		{
+		public:
+			using Callback = std::function<void(const NodePtr&)>;
+
+			StreamMatcher();
+			~StreamMatcher();
+
+			// Returns false, if the path is outside of the streamable subset.
+			bool add(const XPathPtr& xpath, const Callback& callback);
+			bool add(const std::string& xpath, const Namespaces& ns, const Callback& callback)
+			{
+				return add(compile(xpath, ns), callback);
+			}
+
+			void onStartElement(const parsers::sax::Name& name, const parsers::sax::Attributes& attrs) override;
+			void onEndElement(const parsers::sax::Name& name) override;
+			void onText(env::string_ref text) override;
+
+			struct Query;
+			struct Capture;
+		private:
+			enum CAPTURE
+			{
+				CAPTURE_ELEMENT,   // the matched element, for the callback
+				CAPTURE_TEXT,      // text directly inside of the matched element
+				CAPTURE_REMAINDER  // subtree to evaluate the rest of the path on
+			};
+
+			std::vector<std::unique_ptr<Query>> m_queries;
+			std::vector<std::unique_ptr<Capture>> m_captures;
+			DocumentPtr m_scratch;
+			size_t m_depth = 0;
+
+			void startCapture(CAPTURE kind, const Query& query, size_t step, const parsers::sax::Name& name, const parsers::sax::Attributes& attrs);
+		};
+	}
+}
+
+#endif // __DOM_XPATH_STREAM_HPP__
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2015 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+#include <string>
+#include <cstring>
+#include <cctype>
+
+namespace env
+{
+	// Non-owning view of a character range; it is up to the caller to
+	// keep the viewed memory alive for as long as the view is in use.
+	class string_ref {
+		const char* m_data = nullptr;
+		size_t m_length = 0;
+	public:
+		using const_iterator = const char*;
+		static const size_t npos = (size_t)-1;
+
+		string_ref() = default;
+		string_ref(const char* data) : m_data(data), m_length(data ? strlen(data) : 0) {}
+		string_ref(const char* data, size_t length) : m_data(data), m_length(length) {}
+		string_ref(const std::string& s) : m_data(s.data()), m_length(s.length()) {}
+
+		const char* data() const { return m_data; }
+		size_t size() const { return m_length; }
+		size_t length() const { return m_length; }
+		bool empty() const { return !m_length; }
+		const_iterator begin() const { return m_data; }
+		const_iterator end() const { return m_data + m_length; }
+		char operator[](size_t pos) const { return m_data[pos]; }
+
+		std::string str() const { return m_data ? std::string(m_data, m_length) : std::string(); }
+		void append_to(std::string& out) const { if (m_length) out.append(m_data, m_length); }
+
+		string_ref substr(size_t pos, size_t count = npos) const
+		{
+			if (pos > m_length)
+				pos = m_length;
+			if (count > m_length - pos)
+				count = m_length - pos;
+			return { m_data + pos, count };
+		}
+
+		size_t find(char c, size_t pos = 0) const
+		{
+			if (pos >= m_length)
+				return npos;
+			auto ptr = (const char*)memchr(m_data + pos, c, m_length - pos);
+			return ptr ? (size_t)(ptr - m_data) : npos;
+		}
+
+		int compare(const string_ref& rhs) const
+		{
+			auto len = m_length < rhs.m_length ? m_length : rhs.m_length;
+			int ret = len ? memcmp(m_data, rhs.m_data, len) : 0;
+			if (ret)
+				return ret;
+			return m_length < rhs.m_length ? -1 : (m_length > rhs.m_length ? 1 : 0);
+		}
+
+		bool equals_ci(const string_ref& rhs) const
+		{
+			if (m_length != rhs.m_length)
+				return false;
+			for (size_t i = 0; i < m_length; ++i) {
+				if (std::tolower((unsigned char)m_data[i]) != std::tolower((unsigned char)rhs.m_data[i]))
+					return false;
+			}
+			return true;
+		}
+
+		bool operator==(const string_ref& rhs) const
+		{
+			return m_length == rhs.m_length && (!m_length || !memcmp(m_data, rhs.m_data, m_length));
+		}
+		bool operator!=(const string_ref& rhs) const { return !(*this == rhs); }
+		bool operator<(const string_ref& rhs) const { return compare(rhs) < 0; }
+	};
+}
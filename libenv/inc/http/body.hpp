@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2015 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+
+namespace net { namespace http { namespace client {
+
+	// Move-only owner of a response body. Small bodies live on the heap,
+	// a body reserved or grown past the map threshold is moved to an
+	// anonymous memory mapping, which can be resized without copying
+	// and is returned to the system as soon as the body is released.
+	class Body {
+		char* m_data = nullptr;
+		size_t m_size = 0;
+		size_t m_capacity = 0;
+		size_t m_mapThreshold = no_mapping;
+		bool m_mapped = false;
+
+		bool realloc_heap(size_t capacity);
+		bool realloc_mapped(size_t capacity);
+	public:
+		static const size_t no_mapping = (size_t)-1;
+
+		Body() = default;
+		Body(const Body&) = delete;
+		Body& operator=(const Body&) = delete;
+		Body(Body&& oth);
+		Body& operator=(Body&& oth);
+		~Body();
+
+		const char* data() const { return m_data; }
+		char* data() { return m_data; }
+		size_t size() const { return m_size; }
+		size_t capacity() const { return m_capacity; }
+		bool empty() const { return !m_size; }
+		bool mapped() const { return m_mapped; }
+
+		// Bodies of at least that many bytes are kept in anonymous
+		// mappings; no_mapping (the default) turns this off.
+		void setMapThreshold(size_t threshold) { m_mapThreshold = threshold; }
+		size_t mapThreshold() const { return m_mapThreshold; }
+
+		// Makes room for exactly that many bytes, if there is less.
+		bool reserve(size_t capacity);
+		bool append(const void* data, size_t length);
+		void clear();
+	};
+}}}
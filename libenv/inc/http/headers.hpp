@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2015 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iterator>
+#include <env/string_ref.hpp>
+
+namespace net { namespace http { namespace client {
+
+	// Flat, case-insensitive list of HTTP header fields. All names and
+	// values live in one shared character buffer, names are stored in
+	// lower case; clear() keeps the allocated capacity, so a single
+	// object can be refilled for every response without allocating.
+	class Headers {
+		struct entry {
+			size_t name;
+			size_t name_length;
+			size_t value;
+			size_t value_length;
+		};
+
+		std::string m_buffer;
+		std::vector<entry> m_entries;
+		size_t m_last = 0;
+
+		const entry* lookup(env::string_ref name) const;
+		env::string_ref ref(size_t offset, size_t length) const
+		{
+			return { m_buffer.data() + offset, length };
+		}
+	public:
+		struct field {
+			env::string_ref name;
+			env::string_ref value;
+		};
+
+		class const_iterator : public std::iterator<std::forward_iterator_tag, field, ptrdiff_t, const field*, field> {
+			const Headers* m_parent = nullptr;
+			size_t m_index = 0;
+		public:
+			const_iterator() = default;
+			const_iterator(const Headers* parent, size_t index) : m_parent(parent), m_index(index) {}
+
+			field operator*() const { return m_parent->at(m_index); }
+			const_iterator& operator++() { ++m_index; return *this; }
+			const_iterator operator++(int) { auto tmp = *this; ++m_index; return tmp; }
+			bool operator==(const const_iterator& rhs) const { return m_parent == rhs.m_parent && m_index == rhs.m_index; }
+			bool operator!=(const const_iterator& rhs) const { return !(*this == rhs); }
+		};
+		using iterator = const_iterator;
+
+		Headers() = default;
+		Headers(const Headers&) = default;
+		Headers& operator=(const Headers&) = default;
+		Headers(Headers&& oth);
+		Headers& operator=(Headers&& oth);
+
+		bool empty() const { return m_entries.empty(); }
+		size_t size() const { return m_entries.size(); }
+		void clear();
+		void reserve(size_t fields, size_t bytes);
+
+		field at(size_t index) const
+		{
+			auto& e = m_entries[index];
+			return { ref(e.name, e.name_length), ref(e.value, e.value_length) };
+		}
+		const_iterator begin() const { return { this, 0 }; }
+		const_iterator end() const { return { this, m_entries.size() }; }
+
+		// Adds a field; a field with the same name gets the new value
+		// appended after a ", ", as allowed by RFC 7230, 3.2.2.
+		void append(env::string_ref name, env::string_ref value);
+
+		// Continues the value of the most recently appended field (the
+		// obsolete line folding): appends a space and the value.
+		void extend(env::string_ref value);
+
+		bool has(env::string_ref name) const { return lookup(name) != nullptr; }
+
+		// The view is invalidated by any modification of the list.
+		env::string_ref find(env::string_ref name) const;
+		std::string get(env::string_ref name) const { return find(name).str(); }
+	};
+}}}
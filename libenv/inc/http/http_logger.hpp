@@ -25,8 +25,8 @@
 #pragma once
 
 #include <memory>
-#include <map>
 #include <string>
+#include <http/headers.hpp>
 
 
 namespace net { namespace http { namespace client {
@@ -43,7 +43,7 @@ namespace net { namespace http { namespace client {
 		virtual void onFinalLocation(const std::string& location) = 0;
 		virtual void onDebug(const char *data) = 0;
 		virtual void onRequestHeaders(const char* data, size_t length) = 0;
-		virtual void onResponse(const std::string& reason, int http_status, const std::map<std::string, std::string>& headers) = 0;
+		virtual void onResponse(const std::string& reason, int http_status, const Headers& headers) = 0;
 		virtual void onTrace(trace mode, const char *data, size_t size) = 0;
 		virtual void onStop(bool success) = 0;
 	};
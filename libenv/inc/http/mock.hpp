@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2015 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <http/transport.hpp>
+
+namespace net { namespace http { namespace mock {
+
+	// In-process stand-in for a remote server. Requests made through its
+	// transport() never leave the process; the responses are canned or
+	// generated, and delivered with simulated latency and bandwidth, so
+	// timings taken against it are reproducible on an offline machine.
+
+	struct Response
+	{
+		int status = 200;
+		std::string reason = "OK";
+		std::vector<std::pair<std::string, std::string>> headers;
+		std::string body;
+	};
+
+	// Returns false, if the URL is not served by this generator.
+	using Generator = std::function<bool(const std::string& url, Response& out)>;
+
+	struct Conditions
+	{
+		// delay before the headers of each response
+		std::chrono::microseconds latency { 0 };
+		// body delivery speed in bytes per second, 0 for no limit
+		uint64_t bandwidth = 0;
+		// size of the pieces the body is delivered in
+		size_t chunk = 16 * 1024;
+		// probability of a request failing with a transport error,
+		// drawn from a generator seeded with seed
+		double failure_rate = 0.0;
+		unsigned seed = 0;
+	};
+
+	struct Stats
+	{
+		size_t requests = 0;
+		size_t failures = 0;
+		size_t not_found = 0;
+		uint64_t bytes = 0;
+	};
+
+	struct RepoSpec
+	{
+		size_t packages = 1000;
+		size_t dependencies = 8;
+		size_t files = 20;
+		unsigned seed = 1;
+	};
+
+	struct ServerState;
+
+	class Server
+	{
+		std::shared_ptr<ServerState> m_state;
+	public:
+		Server();
+
+		void conditions(const Conditions& conditions);
+		Conditions conditions() const;
+
+		// Serves the response for this exact URL.
+		void add(const std::string& url, Response response);
+		void add(const std::string& url, std::string body, const std::string& content_type);
+
+		// Asks the generator for every URL starting with prefix and not
+		// served by a canned response; generators are consulted in the
+		// order they were added.
+		void add_generator(const std::string& prefix, Generator generator);
+
+		// Serves a synthetic yum repository under root (which should end
+		// with a slash): repodata/repomd.xml, with the primary.xml and
+		// filelists.xml it points to. The contents are produced here,
+		// once, from spec.seed, and are the same on every run.
+		void add_repo(const std::string& root, const RepoSpec& spec);
+
+		Stats stats() const;
+		void reset_stats();
+
+		TransportPtr transport() const;
+	};
+}}}
@@ -31,6 +31,8 @@
 #include <functional>
 #include <future>
 #include <http/http_logger.hpp>
+#include <http/body.hpp>
+#include <http/transport.hpp>
 
 namespace net { namespace http { namespace client {
 	struct HttpResponse;
@@ -55,7 +57,7 @@ namespace net { namespace http { namespace client {
 		virtual int getStatus() const = 0;
 		virtual std::string getStatusText() const = 0;
 		virtual std::string getResponseHeader(const std::string& name) const = 0;
-		virtual std::map<std::string, std::string> getResponseHeaders() const = 0;
+		virtual const Headers& getResponseHeaders() const = 0;
 
 		virtual bool wasRedirected() const = 0;
 		virtual const std::string getFinalLocation() const = 0;
@@ -91,6 +93,10 @@ namespace net { namespace http { namespace client {
 
 		virtual size_t getResponseTextLength() const = 0;
 		virtual const char* getResponseText() const = 0;
+		// Hands the response over to the caller; getResponseText() is empty afterwards.
+		virtual Body takeResponseBody() = 0;
+		// Responses of at least that many bytes are kept in anonymous memory mappings.
+		virtual void setBodyMapThreshold(size_t bytes) = 0;
 
 		virtual void setLogging(const std::shared_ptr<LoggingClient>& logger) = 0;
 		virtual void setShouldFollowLocation(bool follow) = 0;
@@ -100,6 +106,7 @@ namespace net { namespace http { namespace client {
 	};
 
 	XmlHttpRequestPtr create();
+	XmlHttpRequestPtr create(const TransportPtr& transport);
 
 	void set_program_client_info(const char*);
 }}}
@@ -27,6 +27,7 @@
 #include "http/xhr.hpp"
 #include <dom/parsers/xml.hpp>
 #include <dom/dom.hpp>
+#include <dom/dom_xpath.hpp>
 #include <cassert>
 #include <random>
 
@@ -87,6 +88,12 @@ repomd remote_repo::read_index(error& err) const
 
 		auto data = doc->findall("/repo:repomd/repo:data", namespaces);
 		if (data) {
+			auto location = dom::xpath::compile("repo:location/@href", namespaces);
+			auto checksum = dom::xpath::compile("repo:checksum", namespaces);
+			auto open_checksum = dom::xpath::compile("repo:open-checksum", namespaces);
+			if (!location || !checksum || !open_checksum)
+				return error::not_xml;
+
 			auto len = data->length();
 			for (size_t i = 0; i < len; ++i) {
 				auto item = data->element(i);
@@ -101,19 +108,19 @@ repomd remote_repo::read_index(error& err) const
 
 				auto& out_item = type == "primary" ? out.primary : out.filelists;
 
-				auto child = item->find("repo:location/@href", namespaces);
+				auto child = location->find(item);
 				if (!child)
 					continue;
 
 				out_item.location = child->stringValue();
 
-				auto sub = element_cast(item->find("repo:checksum", namespaces));
+				auto sub = element_cast(checksum->find(item));
 				if (sub && sub->hasAttribute("type")) {
 					out_item.chksm.type = sub->getAttribute("type");
 					out_item.chksm.value = sub->stringValue();
 				}
 
-				sub = element_cast(item->find("repo:open-checksum", namespaces));
+				sub = element_cast(open_checksum->find(item));
 				if (sub && sub->hasAttribute("type")) {
 					out_item.open_chksm.type = sub->getAttribute("type");
 					out_item.open_chksm.value = sub->stringValue();
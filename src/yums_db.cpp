@@ -168,6 +168,17 @@ bool yums_db::repos(std::vector<yums_repo>& repos)
 	return db::get(cur, repos);
 }
 
+bool yums_db::repos(const std::function<void(const yums_repo&)>& cb)
+{
+	auto conn = db();
+
+	auto stmt = conn->prepare("SELECT id, name, revision, href FROM repo");
+	if (!stmt)
+		return false;
+
+	return db::for_each<yums_repo>(stmt->query(), cb);
+}
+
 bool yums_db::update(const yums_repo& repo, std::string& reason)
 {
 	using namespace repo;
@@ -209,7 +220,7 @@ bool yums_db::update(const yums_repo& repo, std::string& reason)
 	if (!stmt->execute())
 		return false;
 
-	stmt = conn->prepare("INSERT OR REPLACE INTO datafile (repo_id, type, checksum, open_checksum) VALUES (?, ?, ?, ?)");
+	// the same statement again, with all of its values bound anew
 	stmt->bind(0, repo.id);
 	stmt->bind(1, "filelists");
 	stmt->bind(2, def.filelists.chksm.value);
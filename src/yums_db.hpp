@@ -25,6 +25,7 @@
 #pragma once
 
 #include <data/dbconn.hpp>
+#include <functional>
 
 struct yums_repo {
 	long long id = 0;
@@ -53,5 +54,6 @@ public:
 	bool rm_repo(const std::string& name);
 	bool repo_href(const std::string& name, std::string& url);
 	bool repos(std::vector<yums_repo>& repos);
+	bool repos(const std::function<void(const yums_repo&)>& cb);
 	bool update(const yums_repo& repo, std::string& error);
 };
\ No newline at end of file
@@ -43,13 +43,10 @@ int call(args::parser& parser)
 		parser.error("directory is not initialized", true);
 
 	if (name.empty()) {
-		std::vector<yums_repo> repos;
-		if (!db.repos(repos))
+		auto print = [](const yums_repo& repo) { printf("%s\n", repo.name.c_str()); };
+		if (!db.repos(print))
 			parser.error("could not list repos", true);
 
-		for (auto& repo : repos)
-			printf("%s\n", repo.name.c_str());
-
 		return 0;
 	}
 